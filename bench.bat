@@ -0,0 +1,15 @@
+@echo off
+title Cortex Benchmark
+
+echo Compiling the engine benchmark...
+
+:: Same optimization level as the OS build
+gcc -O2 bench.c nn.c nn_simd.c nn_quant.c nn_stats.c trainer.c -o Bench -pthread
+if %errorlevel% neq 0 (
+    echo [ERROR] Compilation failed.
+    exit /b %errorlevel%
+)
+
+:: Pinned to CPU 0; results go to bench_results.json
+echo Running benchmarks...
+.\Bench --out bench_results.json %*
\ No newline at end of file
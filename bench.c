@@ -0,0 +1,376 @@
+#ifndef _WIN32
+#define _GNU_SOURCE  // sched_setaffinity
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nn.h"
+#include "nn_simd.h"
+#include "nn_quant.h"
+#include "trainer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#define NULL_DEVICE "NUL"
+#else
+#include <sched.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/* =============================================================
+   CORTEX ENGINE BENCHMARK
+   Latency and throughput of the nn.c engine over a grid of
+   topologies, written as JSON for run-to-run comparison.
+   ============================================================= */
+
+/* --- CONFIGURATION --- */
+#define BENCH_SEED 42u
+#define BENCH_BATCH 1024        // Samples per predict_batch call
+#define BENCH_TRAIN_BATCH 16    // Samples per train_batch call (as in main.c)
+#define BENCH_TRAINER_BATCH 256 // Samples per trainer_step call, enough to shard
+#define BENCH_TRAINER_HIDDEN 64 // Narrower networks never split a batch: no trainer rows
+#define BENCH_POOL 4096         // Distinct input rows cycled through
+#define BENCH_CALIBRATION 256   // Rows that calibrate the int8 copy
+#define BENCH_SAMPLE_NS 2000.0  // Latency samples time at least this many calls' worth
+#define BENCH_SAMPLES 1000      // Latency samples per measurement...
+#define BENCH_BUDGET_NS 4e8     // ...unless they would take longer than this
+#define BENCH_WARMUP_NS 5e7
+#define BENCH_FILE "bench_model.tmp"
+
+typedef struct {
+    const char* name;
+    int input, hidden, output;
+} BenchTopology;
+
+// The app brains first, then sizes where the SIMD kernels take over
+static const BenchTopology TOPOLOGIES[] = {
+    { "3-8-1",       3,    8,  1 },  // Doc-AI, Fit-Bot, Spam-Guard
+    { "2-8-1",       2,    8,  1 },  // Neuro-Calc
+    { "16-64-4",    16,   64,  4 },
+    { "64-256-16",  64,  256, 16 },
+    { "256-1024-64", 256, 1024, 64 },
+};
+#define TOPOLOGY_COUNT (int)(sizeof(TOPOLOGIES) / sizeof(TOPOLOGIES[0]))
+
+/* --- UTILITIES --- */
+
+static double now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart * 1e9 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+#ifndef _WIN32
+static cpu_set_t startup_cpus;  // Affinity before pin_cpu(), for the trainer workers
+#endif
+
+// Keeps the benchmark on one core so the scheduler does not add noise
+static int pin_cpu(int cpu) {
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    sched_getaffinity(0, sizeof(startup_cpus), &startup_cpus);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+// Threads inherit their creator's affinity on Linux, so the pool is spawned
+// with the startup mask; the calling thread (worker 0) stays pinned
+static NNTrainer* create_bench_trainer(NeuralNetwork* nn, int threads, int pinned_cpu) {
+#ifndef _WIN32
+    if (pinned_cpu >= 0) sched_setaffinity(0, sizeof(startup_cpus), &startup_cpus);
+#endif
+    NNTrainer* trainer = create_trainer(nn, threads);
+#ifndef _WIN32
+    if (pinned_cpu >= 0) pin_cpu(pinned_cpu);
+#endif
+    return trainer;
+}
+
+// Same generator as the brain trainer: identical data on every platform
+static double bench_rand(unsigned* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (double)((*seed >> 16) & 0x7fff) / 0x7fff;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* --- MEASUREMENT --- */
+
+typedef struct {
+    NeuralNetwork* nn;
+    NNWorkspace* ws;
+    NNQuantNetwork* q;  // Int8 copy of 'nn'
+    NNQuantWorkspace* qws;
+    NNTrainer* trainer;  // Pool of the current trainer_step row
+    double* inputs;   // BENCH_POOL rows
+    double* targets;
+    double* outputs;
+    int next;         // Row of the next single-sample call
+} BenchCase;
+
+// One operation, repeated 'calls' times
+typedef void (*BenchOp)(BenchCase* c, int calls);
+
+typedef struct {
+    double p50, p99, mean;  // ns per call
+    int samples;
+} BenchResult;
+
+// Sorted per-call latencies: each sample times a block of calls sized to
+// BENCH_SAMPLE_NS so the clock's own cost stays out of the figure
+static BenchResult measure(BenchCase* c, BenchOp op) {
+    BenchResult r = { 0 };
+
+    double start = now_ns();
+    int warmup = 0;
+    while (now_ns() - start < BENCH_WARMUP_NS || warmup < 3) {
+        op(c, 1);
+        warmup++;
+    }
+    double per_call = (now_ns() - start) / warmup;
+
+    int block = per_call < BENCH_SAMPLE_NS ? (int)(BENCH_SAMPLE_NS / per_call) + 1 : 1;
+    int samples = BENCH_SAMPLES;
+    if (samples * block * per_call > BENCH_BUDGET_NS) samples = (int)(BENCH_BUDGET_NS / (block * per_call));
+    if (samples < 10) samples = 10;
+
+    double* times = malloc(sizeof(double) * samples);
+    if (!times) return r;
+    for(int s = 0; s < samples; s++) {
+        double t0 = now_ns();
+        op(c, block);
+        times[s] = (now_ns() - t0) / block;
+        r.mean += times[s];
+    }
+    qsort(times, samples, sizeof(double), compare_doubles);
+    r.p50 = times[samples / 2];
+    r.p99 = times[(int)(samples * 0.99)];
+    r.mean /= samples;
+    r.samples = samples;
+    free(times);
+    return r;
+}
+
+static const double* next_row(BenchCase* c, const double** target) {
+    int row = c->next;
+    c->next = (c->next + 1) % BENCH_POOL;
+    if (target) *target = c->targets + (size_t)row * c->nn->output_nodes;
+    return c->inputs + (size_t)row * c->nn->input_nodes;
+}
+
+// First row of the next n-sample batch, wrapping early so it stays inside the pool
+static int next_batch(BenchCase* c, int n) {
+    if (c->next + n > BENCH_POOL) c->next = 0;
+    int row = c->next;
+    c->next = (c->next + n) % BENCH_POOL;
+    return row;
+}
+
+static void op_predict_into(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) predict_into(c->nn, c->ws, next_row(c, NULL), c->outputs);
+}
+
+// The one-shot wrapper, workspace and result allocation included
+static void op_predict(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) free(predict(c->nn, (double*)next_row(c, NULL)));
+}
+
+static void op_predict_batch(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) {
+        predict_batch_with_workspace(c->nn, c->ws, c->inputs + (size_t)(i % (BENCH_POOL / BENCH_BATCH)) * BENCH_BATCH * c->nn->input_nodes,
+                                     BENCH_BATCH, c->outputs);
+    }
+}
+
+static void op_quant_predict(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) quant_predict_into(c->q, c->qws, next_row(c, NULL), c->outputs);
+}
+
+static void op_quant_predict_batch(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) {
+        quant_predict_batch(c->q, c->qws, c->inputs + (size_t)(i % (BENCH_POOL / BENCH_BATCH)) * BENCH_BATCH * c->nn->input_nodes,
+                            BENCH_BATCH, c->outputs);
+    }
+}
+
+static void op_train(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) {
+        const double* target;
+        const double* x = next_row(c, &target);
+        train_with_workspace(c->nn, c->ws, x, target, 0.1);
+    }
+}
+
+static void op_train_batch(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) {
+        int row = next_batch(c, BENCH_TRAIN_BATCH);
+        train_batch(c->nn, c->ws, c->inputs + (size_t)row * c->nn->input_nodes,
+                    c->targets + (size_t)row * c->nn->output_nodes, BENCH_TRAIN_BATCH, 0.1 * BENCH_TRAIN_BATCH);
+    }
+}
+
+static void op_trainer_step(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) {
+        int row = next_batch(c, BENCH_TRAINER_BATCH);
+        trainer_step(c->trainer, c->inputs + (size_t)row * c->nn->input_nodes,
+                     c->targets + (size_t)row * c->nn->output_nodes, BENCH_TRAINER_BATCH, 0.1 * BENCH_TRAINER_BATCH);
+    }
+}
+
+static void op_save(BenchCase* c, int calls) {
+    for(int i = 0; i < calls; i++) save_network(c->nn, BENCH_FILE);
+}
+
+static void op_load(BenchCase* c, int calls) {
+    (void)c;
+    for(int i = 0; i < calls; i++) free_network(load_network(BENCH_FILE));
+}
+
+static void op_load_copy(BenchCase* c, int calls) {
+    (void)c;
+    for(int i = 0; i < calls; i++) free_network(load_network_ex(BENCH_FILE, NN_LOAD_COPY | NN_LOAD_VERIFY));
+}
+
+typedef struct {
+    const char* name;
+    BenchOp op;
+    int samples_per_call;  // For the throughput figure
+    int int8;              // Runs the quantized copy
+    int threads;           // trainer_step pool size (-1: one per core, 0: not a trainer row)
+} BenchSpec;
+
+static const BenchSpec BENCHMARKS[] = {
+    { "predict_into",        op_predict_into,        1,                   0,  0 },
+    { "predict",             op_predict,             1,                   0,  0 },
+    { "predict_batch",       op_predict_batch,       BENCH_BATCH,         0,  0 },
+    { "quant_predict",       op_quant_predict,       1,                   1,  0 },
+    { "quant_predict_batch", op_quant_predict_batch, BENCH_BATCH,         1,  0 },
+    { "train",               op_train,               1,                   0,  0 },
+    { "train_batch",         op_train_batch,         BENCH_TRAIN_BATCH,   0,  0 },
+    { "trainer_step x1",     op_trainer_step,        BENCH_TRAINER_BATCH, 0,  1 },
+    { "trainer_step x2",     op_trainer_step,        BENCH_TRAINER_BATCH, 0,  2 },
+    { "trainer_step x4",     op_trainer_step,        BENCH_TRAINER_BATCH, 0,  4 },
+    { "trainer_step xN",     op_trainer_step,        BENCH_TRAINER_BATCH, 0, -1 },
+    { "save_network",        op_save,                1,                   0,  0 },
+    { "load_network",        op_load,                1,                   0,  0 },
+    { "load_copy",           op_load_copy,           1,                   0,  0 },
+};
+#define BENCHMARK_COUNT (int)(sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]))
+
+/* --- REPORT --- */
+
+static void usage(void) {
+    fprintf(stderr, "Usage: Bench [--out results.json] [--cpu N] [--seed N] [--only 3-8-1]\n");
+    fprintf(stderr, "  --cpu -1 leaves the process unpinned (default: CPU 0)\n");
+}
+
+int main(int argc, char** argv) {
+    const char* out_path = "bench_results.json";
+    const char* only = NULL;
+    int cpu = 0;
+    unsigned seed = BENCH_SEED;
+    for(int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) cpu = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) only = argv[++i];
+        else { usage(); return 2; }
+    }
+
+    // The engine reports every save and load on stdout; keep that out of the timings
+    fflush(stdout);
+    if (!freopen(NULL_DEVICE, "w", stdout)) fprintf(stderr, "Warning: engine messages stay on stdout.\n");
+
+    int pinned = cpu >= 0 && pin_cpu(cpu);
+    if (cpu >= 0 && !pinned) fprintf(stderr, "Warning: could not pin to CPU %d.\n", cpu);
+
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: cannot create '%s'.\n", out_path);
+        return 1;
+    }
+    fprintf(out, "{\n  \"engine\": {\"simd\": \"%s\", \"seed\": %u, \"cpu\": %d, \"cpus\": %d, \"batch\": %d, "
+            "\"train_batch\": %d, \"trainer_batch\": %d},\n",
+            nn_kernels()->name, seed, pinned ? cpu : -1, nn_cpu_count(), BENCH_BATCH, BENCH_TRAIN_BATCH, BENCH_TRAINER_BATCH);
+    fprintf(out, "  \"results\": [");
+    fprintf(stderr, "%-12s %-20s %12s %12s %14s %12s\n", "topology", "benchmark", "p50 (ns)", "p99 (ns)", "samples/s",
+            "model bytes");
+
+    int first = 1, failed = 0;
+    for(int t = 0; t < TOPOLOGY_COUNT; t++) {
+        const BenchTopology* topo = &TOPOLOGIES[t];
+        if (only && strcmp(only, topo->name) != 0) continue;
+
+        // Fixed seed per topology: weights and data do not depend on what ran before
+        unsigned rng = seed + (unsigned)t;
+        srand(rng);
+        BenchCase c = { 0 };
+        c.nn = create_network(topo->input, topo->hidden, topo->output);
+        if (c.nn) init_network(c.nn);
+        c.ws = c.nn ? create_workspace(c.nn) : NULL;
+        c.inputs = malloc(sizeof(double) * BENCH_POOL * topo->input);
+        c.targets = malloc(sizeof(double) * BENCH_POOL * topo->output);
+        c.outputs = malloc(sizeof(double) * BENCH_BATCH * topo->output);
+        if (c.ws && c.inputs) {
+            for(int i = 0; i < BENCH_POOL * topo->input; i++) c.inputs[i] = bench_rand(&rng);
+            c.q = quantize_network(c.nn, c.inputs, BENCH_CALIBRATION);
+            c.qws = c.q ? create_quant_workspace(c.q) : NULL;
+        }
+        if (!c.qws || !c.targets || !c.outputs) {
+            fprintf(stderr, "Error: out of memory for %s.\n", topo->name);
+            failed = 1;
+        } else {
+            for(int i = 0; i < BENCH_POOL * topo->output; i++) c.targets[i] = bench_rand(&rng) > 0.5;
+
+            for(int b = 0; b < BENCHMARK_COUNT; b++) {
+                const BenchSpec* spec = &BENCHMARKS[b];
+                if (spec->threads && topo->hidden < BENCH_TRAINER_HIDDEN) continue;
+                if (spec->threads && !(c.trainer = create_bench_trainer(c.nn, spec->threads, pinned ? cpu : -1))) {
+                    fprintf(stderr, "Error: cannot start %s for %s.\n", spec->name, topo->name);
+                    failed = 1;
+                    continue;
+                }
+                BenchResult r = measure(&c, spec->op);
+                free_trainer(c.trainer);
+                c.trainer = NULL;
+                double throughput = r.mean > 0 ? spec->samples_per_call * 1e9 / r.mean : 0.0;
+                size_t bytes = spec->int8 ? quant_network_memory(c.q) : network_memory(c.nn);
+                fprintf(out, "%s\n    {\"topology\": \"%s\", \"benchmark\": \"%s\", \"p50_ns\": %.1f, \"p99_ns\": %.1f, "
+                        "\"mean_ns\": %.1f, \"samples\": %d, \"samples_per_sec\": %.0f, \"model_bytes\": %zu}",
+                        first ? "" : ",", topo->name, spec->name, r.p50, r.p99, r.mean, r.samples, throughput, bytes);
+                fprintf(stderr, "%-12s %-20s %12.1f %12.1f %14.0f %12zu\n", topo->name, spec->name, r.p50, r.p99,
+                        throughput, bytes);
+                first = 0;
+            }
+        }
+        free(c.inputs);
+        free(c.targets);
+        free(c.outputs);
+        free_quant_workspace(c.qws);
+        free_quant_network(c.q);
+        free_workspace(c.ws);
+        free_network(c.nn);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    remove(BENCH_FILE);
+
+    if (fclose(out) != 0) failed = 1;
+    if (!failed) fprintf(stderr, ">> Results written to '%s'\n", out_path);
+    return failed;
+}
@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "learner.h"
+
+typedef struct {
+    char* name;
+    NNModelSlot* slot;
+    NNSlotReader* reader;
+    int inputs;
+    int outputs;
+
+    // Under the learner's lock: a ring of 'capacity' samples
+    double* queue_inputs;
+    double* queue_targets;
+    int head;
+    int count;
+    uint64_t oldest_at;  // When the oldest queued sample came (ms)
+    const NeuralNetwork* replacement;  // Acquired, waiting to be swapped in
+
+    // Learner thread only
+    NeuralNetwork* shadow;
+    NNWorkspace* ws;
+    double* batch_inputs;   // Samples taken off the queue
+    double* batch_targets;
+    int dirty;              // Trained since the last checkpoint
+} LearnerBrain;
+
+struct NNLearner {
+    NNRegistry* reg;
+    NNLearnerOptions options;
+    LearnerBrain brains[LEARNER_MAX_BRAINS];
+    int count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;  // Samples, a replacement, or stopping
+    int stop;
+    int started;
+    pthread_t thread;
+    NNLearnerStats stats;    // Under 'lock'
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static void wait_ms(NNLearner* l, uint64_t ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(ms / 1000);
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+    pthread_cond_timedwait(&l->changed, &l->lock, &deadline);
+}
+
+// --- Brains (learner thread) ---
+
+// Replaces the shadow with a private copy of 'nn'
+static int set_shadow(LearnerBrain* b, const NeuralNetwork* nn) {
+    NeuralNetwork* copy = convert_network(nn, nn->precision);
+    NNWorkspace* ws = copy ? create_workspace(copy) : NULL;
+    if (!ws) {
+        free_network(copy);
+        return 0;
+    }
+    free_workspace(b->ws);
+    free_network(b->shadow);
+    b->shadow = copy;
+    b->ws = ws;
+    b->dirty = 0;
+    return 1;
+}
+
+// Moves the queued samples to the batch buffers, oldest first
+static int take_samples(LearnerBrain* b, int capacity) {
+    int n = b->count;
+    for(int i = 0; i < n; i++) {
+        int at = (b->head + i) % capacity;
+        memcpy(b->batch_inputs + (size_t)i * b->inputs, b->queue_inputs + (size_t)at * b->inputs, b->inputs * sizeof(double));
+        memcpy(b->batch_targets + (size_t)i * b->outputs, b->queue_targets + (size_t)at * b->outputs, b->outputs * sizeof(double));
+    }
+    b->head = (b->head + n) % capacity;
+    b->count = 0;
+    return n;
+}
+
+// Mini-batches over the taken samples; returns the updates made
+static int learn(NNLearner* l, LearnerBrain* b, int n) {
+    int updates = 0;
+    for(int i = 0; i < n; i += l->options.batch) {
+        int m = n - i < l->options.batch ? n - i : l->options.batch;
+        train_batch(b->shadow, b->ws, b->batch_inputs + (size_t)i * b->inputs,
+                    b->batch_targets + (size_t)i * b->outputs, m, l->options.rate);
+        updates++;
+    }
+    b->dirty = 1;
+    return updates;
+}
+
+// Readers keep the brain they pinned; the shadow itself is never shared
+static int publish(NNLearner* l, LearnerBrain* b) {
+    NeuralNetwork* copy = convert_network(b->shadow, b->shadow->precision);
+    const NeuralNetwork* nn = copy ? registry_publish(l->reg, b->name, copy) : NULL;
+    return nn && slot_swap(b->slot, nn);
+}
+
+static void checkpoint(NNLearner* l, int brain) {
+    LearnerBrain* b = &l->brains[brain];
+    if (l->options.save) l->options.save(l->options.save_ctx, brain, b->shadow);
+    else save_network(b->shadow, b->name);
+    b->dirty = 0;
+}
+
+static int any_dirty(const NNLearner* l) {
+    for(int i = 0; i < l->count; i++) {
+        if (l->brains[i].dirty) return 1;
+    }
+    return 0;
+}
+
+// Under the lock: samples or replacements to handle
+static int pending(const NNLearner* l, int full_batch) {
+    for(int i = 0; i < l->count; i++) {
+        const LearnerBrain* b = &l->brains[i];
+        if (b->replacement || b->count >= (full_batch ? l->options.batch : 1)) return 1;
+    }
+    return 0;
+}
+
+// Under the lock: when the oldest partial batch is due, 0 without samples
+static uint64_t flush_due(const NNLearner* l) {
+    uint64_t due = 0;
+    for(int i = 0; i < l->count; i++) {
+        const LearnerBrain* b = &l->brains[i];
+        if (b->count && (!due || b->oldest_at + LEARNER_FLUSH_MS < due)) due = b->oldest_at + LEARNER_FLUSH_MS;
+    }
+    return due;
+}
+
+// Under the lock: sleeps until a full batch or a replacement is pending, a
+// partial batch or a checkpoint is due, or the learner stops
+static void wait_for_work(NNLearner* l, uint64_t last_checkpoint) {
+    while (!l->stop && !pending(l, 1)) {
+        uint64_t now = now_ms();
+        uint64_t wake = flush_due(l);
+        if (any_dirty(l) && l->options.checkpoint_ms > 0) {
+            uint64_t due = last_checkpoint + (uint64_t)l->options.checkpoint_ms;
+            if (!wake || due < wake) wake = due;
+        }
+        if (!wake) pthread_cond_wait(&l->changed, &l->lock);
+        else if (wake > now) wait_ms(l, wake - now);
+        else return;
+    }
+}
+
+static void* learner_main(void* arg) {
+    NNLearner* l = arg;
+    uint64_t last_checkpoint = now_ms();
+    pthread_mutex_lock(&l->lock);
+    while (1) {
+        wait_for_work(l, last_checkpoint);
+        int stopping = l->stop;
+
+        for(int i = 0; i < l->count; i++) {
+            LearnerBrain* b = &l->brains[i];
+            const NeuralNetwork* replacement = b->replacement;
+            b->replacement = NULL;
+            int n = take_samples(b, l->options.capacity);
+            if (!n && !replacement) continue;
+            pthread_mutex_unlock(&l->lock);
+            if (replacement) {
+                set_shadow(b, replacement);
+                slot_swap(b->slot, replacement);
+            }
+            int updates = n ? learn(l, b, n) : 0;
+            int published = n && publish(l, b);
+            pthread_mutex_lock(&l->lock);
+            l->stats.updates += updates;
+            l->stats.publishes += published;
+        }
+
+        uint64_t now = now_ms();
+        int due = l->options.checkpoint_ms > 0 && now - last_checkpoint >= (uint64_t)l->options.checkpoint_ms;
+        if (stopping || due) {
+            last_checkpoint = now;
+            for(int i = 0; i < l->count; i++) {
+                if (!l->brains[i].dirty) continue;
+                pthread_mutex_unlock(&l->lock);
+                checkpoint(l, i);
+                pthread_mutex_lock(&l->lock);
+                l->stats.checkpoints++;
+            }
+        }
+        if (stopping && !pending(l, 0)) break;
+    }
+    pthread_mutex_unlock(&l->lock);
+    return NULL;
+}
+
+// --- Lifecycle ---
+
+static int init_brain(NNLearner* l, LearnerBrain* b, const char* name, NNModelSlot* slot) {
+    size_t capacity = (size_t)l->options.capacity;
+    b->slot = slot;
+    b->inputs = slot_inputs(slot);
+    b->outputs = slot_outputs(slot);
+    b->name = malloc(strlen(name) + 1);
+    b->reader = slot_reader(slot);
+    b->queue_inputs = malloc(capacity * b->inputs * sizeof(double));
+    b->queue_targets = malloc(capacity * b->outputs * sizeof(double));
+    b->batch_inputs = malloc(capacity * b->inputs * sizeof(double));
+    b->batch_targets = malloc(capacity * b->outputs * sizeof(double));
+    if (!b->name || !b->reader || !b->queue_inputs || !b->queue_targets || !b->batch_inputs || !b->batch_targets) return 0;
+    strcpy(b->name, name);
+
+    int ok = set_shadow(b, slot_pin(b->reader));
+    slot_unpin(b->reader);
+    return ok;
+}
+
+static void free_brain(NNLearner* l, LearnerBrain* b) {
+    registry_release(l->reg, b->replacement);
+    free_workspace(b->ws);
+    free_network(b->shadow);
+    free(b->name);
+    free(b->queue_inputs);
+    free(b->queue_targets);
+    free(b->batch_inputs);
+    free(b->batch_targets);
+}
+
+NNLearner* create_learner(NNRegistry* reg, const char* const* names, NNModelSlot* const* slots, int count,
+                          const NNLearnerOptions* options) {
+    if (count <= 0 || count > LEARNER_MAX_BRAINS) return NULL;
+    NNLearner* l = calloc(1, sizeof(NNLearner));
+    if (!l) return NULL;
+    l->reg = reg;
+    l->options = *options;
+    if (l->options.batch <= 0) l->options.batch = 16;
+    if (l->options.capacity <= 0) l->options.capacity = 4096;
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->changed, NULL);
+
+    int ok = 1;
+    for(l->count = 0; ok && l->count < count; l->count++) ok = init_brain(l, &l->brains[l->count], names[l->count], slots[l->count]);
+    if (ok) ok = l->started = pthread_create(&l->thread, NULL, learner_main, l) == 0;
+    if (!ok) {
+        free_learner(l);
+        return NULL;
+    }
+    return l;
+}
+
+void free_learner(NNLearner* learner) {
+    if (!learner) return;
+    if (learner->started) {
+        pthread_mutex_lock(&learner->lock);
+        learner->stop = 1;
+        pthread_cond_signal(&learner->changed);
+        pthread_mutex_unlock(&learner->lock);
+        pthread_join(learner->thread, NULL);
+    }
+    for(int i = 0; i < learner->count; i++) free_brain(learner, &learner->brains[i]);
+    pthread_mutex_destroy(&learner->lock);
+    pthread_cond_destroy(&learner->changed);
+    free(learner);
+}
+
+// --- Operations ---
+
+// One NaN or infinity would spread through every weight it touches
+static int finite_values(const double* values, int n) {
+    for(int i = 0; i < n; i++) {
+        if (!isfinite(values[i])) return 0;
+    }
+    return 1;
+}
+
+int learner_feed(NNLearner* learner, int brain, const double* inputs, const double* targets) {
+    LearnerBrain* b = &learner->brains[brain];
+    if (!finite_values(inputs, b->inputs) || !finite_values(targets, b->outputs)) {
+        pthread_mutex_lock(&learner->lock);
+        learner->stats.rejected++;
+        pthread_mutex_unlock(&learner->lock);
+        return 0;
+    }
+    pthread_mutex_lock(&learner->lock);
+    if (b->count == learner->options.capacity) {
+        learner->stats.dropped++;
+        pthread_mutex_unlock(&learner->lock);
+        return 0;
+    }
+    int at = (b->head + b->count) % learner->options.capacity;
+    memcpy(b->queue_inputs + (size_t)at * b->inputs, inputs, b->inputs * sizeof(double));
+    memcpy(b->queue_targets + (size_t)at * b->outputs, targets, b->outputs * sizeof(double));
+    if (b->count++ == 0) b->oldest_at = now_ms();
+    learner->stats.samples++;
+    // The first sample starts the flush timer, a full batch goes at once
+    if (b->count == 1 || b->count == learner->options.batch) pthread_cond_signal(&learner->changed);
+    pthread_mutex_unlock(&learner->lock);
+    return 1;
+}
+
+int learner_replace(NNLearner* learner, int brain, const NeuralNetwork* nn) {
+    LearnerBrain* b = &learner->brains[brain];
+    if (!nn || nn->input_nodes != b->inputs || nn->output_nodes != b->outputs) {
+        registry_release(learner->reg, nn);
+        return 0;
+    }
+    pthread_mutex_lock(&learner->lock);
+    const NeuralNetwork* older = b->replacement;
+    b->replacement = nn;
+    pthread_cond_signal(&learner->changed);
+    pthread_mutex_unlock(&learner->lock);
+    registry_release(learner->reg, older);
+    return 1;
+}
+
+NNLearnerStats learner_stats(NNLearner* learner) {
+    pthread_mutex_lock(&learner->lock);
+    NNLearnerStats stats = learner->stats;
+    pthread_mutex_unlock(&learner->lock);
+    return stats;
+}
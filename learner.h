@@ -0,0 +1,53 @@
+#ifndef LEARNER_H
+#define LEARNER_H
+
+#include "nn.h"
+#include "registry.h"
+
+// Online learning from labelled feedback.
+// Serving threads queue samples; one background thread applies them in
+// mini-batches to a private shadow copy of each brain, then publishes a copy
+// of the shadow through the brain's slot, so inference never waits on
+// training. Changed shadows are saved every 'checkpoint_ms'. A sample waits
+// at most LEARNER_FLUSH_MS for its batch to fill.
+#define LEARNER_MAX_BRAINS 16
+#define LEARNER_FLUSH_MS 100
+
+typedef struct NNLearner NNLearner;
+
+typedef struct {
+    int batch;          // Samples per update, <= 0: 16
+    double rate;        // Step for the mean gradient, as in train_batch
+    int capacity;       // Queued samples per brain before feedback is refused, <= 0: 4096
+    int checkpoint_ms;  // <= 0: only when the learner is freed
+    // Saves a checkpoint, NULL: save_network(nn, name)
+    void (*save)(void* ctx, int brain, NeuralNetwork* nn);
+    void* save_ctx;
+} NNLearnerOptions;
+
+typedef struct {
+    long long samples;      // Accepted
+    long long dropped;      // Refused, queue full
+    long long rejected;     // Refused, not finite
+    long long updates;      // train_batch calls
+    long long publishes;    // Shadow copies swapped in
+    long long checkpoints;
+} NNLearnerStats;
+
+// --- Lifecycle ---
+// Brain i is published as names[i] in the registry and served from slots[i]
+NNLearner* create_learner(NNRegistry* reg, const char* const* names, NNModelSlot* const* slots, int count,
+                          const NNLearnerOptions* options);
+void free_learner(NNLearner* learner);  // Applies what is queued, checkpoints and stops
+
+// --- Operations ---
+// Copies one sample (input_nodes inputs, output_nodes targets). 0 when full
+// or when a value is not finite.
+int learner_feed(NNLearner* learner, int brain, const double* inputs, const double* targets);
+// Takes over an acquired reference (e.g. a brain reloaded from disk): the
+// learner thread restarts the shadow from it and swaps it in, so it cannot
+// race a publish. 0 (and 'nn' released) when its inputs or outputs differ.
+int learner_replace(NNLearner* learner, int brain, const NeuralNetwork* nn);
+NNLearnerStats learner_stats(NNLearner* learner);
+
+#endif
@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "mailbox.h"
+#include "nn.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+typedef struct {
+    size_t offset;  // mbox: "From " line
+    size_t start;   // mbox: first header byte
+    size_t length;
+    char* file;     // Maildir: path inside the directory
+} MailEntry;
+
+struct Mailbox {
+    MailboxFormat format;
+    char* path;
+    MailEntry* entries;
+    long count;
+    long capacity;
+
+    // mbox mapping
+    const char* data;
+    size_t size;
+};
+
+// One worker's share of the archive, on its own cache lines
+typedef struct {
+    pthread_mutex_t lock;
+    long next;  // Unclaimed messages: [next, end)
+    long end;
+
+    const Mailbox* box;
+    struct MailPool* pool;
+    int index;
+    pthread_t thread;
+    MailboxScanStats stats;
+} MailWorker;
+
+typedef struct MailPool {
+    int threads;
+    MailWorker** workers;
+    MailVisitFn visit;
+    void* ctx;
+} MailPool;
+
+// --- Entries ---
+
+static MailEntry* add_entry(Mailbox* box) {
+    if (box->count == box->capacity) {
+        long capacity = box->capacity ? box->capacity * 2 : 1024;
+        MailEntry* grown = realloc(box->entries, sizeof(MailEntry) * capacity);
+        if (!grown) return NULL;
+        box->entries = grown;
+        box->capacity = capacity;
+    }
+    MailEntry* e = &box->entries[box->count++];
+    memset(e, 0, sizeof(MailEntry));
+    return e;
+}
+
+// --- mbox ---
+
+// Read-only mapping of a whole file; NULL with *size 0 for an empty file
+static const char* map_mbox(const char* path, size_t* size) {
+    *size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER length;
+    void* base = NULL;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        if (base) *size = (size_t)length.QuadPart;
+    }
+    CloseHandle(file);
+    return base;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void* base = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) base = NULL;
+        else {
+            *size = (size_t)st.st_size;
+            madvise(base, *size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+    return base;
+#endif
+}
+
+static void unmap_mbox(const char* data, size_t size) {
+    if (!data) return;
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+// Ends the message started at 'start', dropping the blank line that
+// separates it from the next "From " line
+static int close_message(Mailbox* box, size_t offset, size_t start, size_t end, int separated) {
+    if (separated) {
+        if (end > start && box->data[end - 1] == '\n') end--;
+        if (end > start && box->data[end - 1] == '\r') end--;
+    }
+    MailEntry* e = add_entry(box);
+    if (!e) return 0;
+    e->offset = offset;
+    e->start = start;
+    e->length = end - start;
+    return 1;
+}
+
+// A message starts at each "From " line that opens the file or follows a
+// blank line. Text before the first one, if any, counts as a message too.
+static int split_mbox(Mailbox* box) {
+    const char* data = box->data;
+    size_t size = box->size;
+    size_t offset = 0, start = 0;
+    int open = 0, blank = 1;
+
+    for(size_t line = 0; line < size; ) {
+        const char* nl = memchr(data + line, '\n', size - line);
+        size_t next = nl ? (size_t)(nl - data) + 1 : size;
+        if (blank && size - line >= 5 && memcmp(data + line, "From ", 5) == 0) {
+            if ((open || line > 0) && !close_message(box, offset, start, line, line > 0)) return 0;
+            offset = line;
+            start = next;
+            open = 1;
+        }
+        size_t length = next - line;
+        blank = length == 1 || (length == 2 && data[line] == '\r');
+        line = next;
+    }
+    if ((open || size > 0) && !close_message(box, offset, start, size, 0)) return 0;
+    return 1;
+}
+
+// --- Maildir ---
+
+static int by_file(const void* a, const void* b) {
+    return strcmp(((const MailEntry*)a)->file, ((const MailEntry*)b)->file);
+}
+
+// Adds the regular files of path/sub (or of path itself when sub is NULL);
+// returns -1 if the directory does not exist, 0 on allocation failure
+static int list_messages(Mailbox* box, const char* sub) {
+    size_t base = strlen(box->path);
+    char* dir_path = malloc(base + (sub ? strlen(sub) : 0) + 2);
+    if (!dir_path) return 0;
+    sprintf(dir_path, sub ? "%s/%s" : "%s", box->path, sub);
+    DIR* dir = opendir(dir_path);
+    free(dir_path);
+    if (!dir) return -1;
+
+    int ok = 1;
+    struct dirent* d;
+    while (ok && (d = readdir(dir))) {
+        if (d->d_name[0] == '.') continue;  // ".", ".." and hidden files
+        char* file = malloc((sub ? strlen(sub) + 1 : 0) + strlen(d->d_name) + 1);
+        if (!file) { ok = 0; break; }
+        sprintf(file, sub ? "%s/%s" : "%s%s", sub ? sub : "", d->d_name);
+
+        char* full = malloc(base + strlen(file) + 2);
+        struct stat st;
+        int regular = full && (sprintf(full, "%s/%s", box->path, file), stat(full, &st) == 0) && S_ISREG(st.st_mode);
+        free(full);
+        MailEntry* e = regular ? add_entry(box) : NULL;
+        if (!e) {
+            free(file);
+            ok = !regular;
+            continue;
+        }
+        e->file = file;
+        e->length = (size_t)st.st_size;
+    }
+    closedir(dir);
+    return ok;
+}
+
+// --- Lifecycle ---
+
+Mailbox* open_mailbox(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return NULL;
+    Mailbox* box = calloc(1, sizeof(Mailbox));
+    if (!box) return NULL;
+    box->path = malloc(strlen(path) + 1);
+    if (!box->path) {
+        free(box);
+        return NULL;
+    }
+    strcpy(box->path, path);
+
+    int ok;
+    if (S_ISDIR(st.st_mode)) {
+        box->format = MAILBOX_MAILDIR;
+        int fresh = list_messages(box, "new");
+        int seen = fresh ? list_messages(box, "cur") : 0;
+        if (fresh < 0 && seen < 0) ok = list_messages(box, NULL) == 1;
+        else ok = fresh != 0 && seen != 0;
+        if (ok && box->count > 1) qsort(box->entries, box->count, sizeof(MailEntry), by_file);
+    } else {
+        box->format = MAILBOX_MBOX;
+        box->data = map_mbox(path, &box->size);
+        ok = (box->data || st.st_size == 0) && split_mbox(box);
+    }
+    if (!ok) {
+        close_mailbox(box);
+        return NULL;
+    }
+    return box;
+}
+
+void close_mailbox(Mailbox* box) {
+    if (!box) return;
+    for(long i = 0; i < box->count; i++) free(box->entries[i].file);
+    free(box->entries);
+    unmap_mbox(box->data, box->size);
+    free(box->path);
+    free(box);
+}
+
+// --- Operations ---
+
+MailboxFormat mailbox_format(const Mailbox* box) { return box->format; }
+long mailbox_count(const Mailbox* box) { return box->count; }
+size_t mailbox_offset(const Mailbox* box, long index) { return box->entries[index].offset; }
+const char* mailbox_file(const Mailbox* box, long index) { return box->entries[index].file; }
+
+int mailbox_read(const Mailbox* box, long index, MailMessage* msg) {
+    const MailEntry* e = &box->entries[index];
+    if (box->format == MAILBOX_MBOX) {
+        msg->data = box->data + e->start;
+        msg->length = e->length;
+        return 1;
+    }
+
+    msg->data = NULL;
+    msg->length = 0;
+    char* full = malloc(strlen(box->path) + strlen(e->file) + 2);
+    if (!full) return 0;
+    sprintf(full, "%s/%s", box->path, e->file);
+    FILE* file = fopen(full, "rb");
+    free(full);
+    if (!file) return 0;
+
+    // Read to the end: the file may have changed since it was listed
+    size_t length = 0;
+    int ok = 1;
+    while (ok) {
+        if (length == msg->capacity) {
+            size_t capacity = msg->capacity ? msg->capacity * 2 : (e->length + 1 > 4096 ? e->length + 1 : 4096);
+            char* grown = realloc(msg->buffer, capacity);
+            if (!grown) { ok = 0; break; }
+            msg->buffer = grown;
+            msg->capacity = capacity;
+        }
+        size_t got = fread(msg->buffer + length, 1, msg->capacity - length, file);
+        length += got;
+        if (got == 0) {
+            ok = !ferror(file);
+            break;
+        }
+    }
+    fclose(file);
+    if (!ok) return 0;
+    msg->data = msg->buffer;
+    msg->length = length;
+    return 1;
+}
+
+void mail_message_free(MailMessage* msg) {
+    free(msg->buffer);
+    msg->buffer = NULL;
+    msg->capacity = 0;
+}
+
+// --- Work-Stealing Pool ---
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Claims up to MAILBOX_CHUNK messages from the front of the worker's share
+static int claim(MailWorker* w, long* first, long* last) {
+    pthread_mutex_lock(&w->lock);
+    int found = w->next < w->end;
+    if (found) {
+        *first = w->next;
+        *last = w->end - w->next > MAILBOX_CHUNK ? w->next + MAILBOX_CHUNK : w->end;
+        w->next = *last;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return found;
+}
+
+// Moves the back half of another worker's share to 'w'; 0 once all are empty
+static int steal(MailWorker* w) {
+    MailPool* pool = w->pool;
+    for(int k = 1; k < pool->threads; k++) {
+        MailWorker* victim = pool->workers[(w->index + k) % pool->threads];
+        pthread_mutex_lock(&victim->lock);
+        long left = victim->end - victim->next;
+        long first = victim->end - (left + 1) / 2;
+        long last = victim->end;
+        if (left > 0) victim->end = first;
+        pthread_mutex_unlock(&victim->lock);
+        if (left <= 0) continue;
+
+        pthread_mutex_lock(&w->lock);
+        w->next = first;
+        w->end = last;
+        pthread_mutex_unlock(&w->lock);
+        w->stats.steals++;
+        return 1;
+    }
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    MailWorker* w = arg;
+    MailPool* pool = w->pool;
+    MailMessage msg = { 0 };
+    long first, last;
+    do {
+        while (claim(w, &first, &last)) {
+            for(long i = first; i < last; i++) {
+                int ok = mailbox_read(w->box, i, &msg);
+                pool->visit(pool->ctx, w->index, i, ok ? &msg : NULL);
+                w->stats.messages++;
+                w->stats.bytes += msg.length;
+                if (!ok) w->stats.failed++;
+            }
+        }
+    } while (steal(w));
+    mail_message_free(&msg);
+    return NULL;
+}
+
+MailboxScanStats mailbox_scan(const Mailbox* box, int threads, MailVisitFn visit, void* ctx) {
+    MailboxScanStats total = { 0 };
+    if (threads <= 0) threads = nn_cpu_count();
+
+    MailPool pool = { threads, NULL, visit, ctx };
+    pool.workers = calloc(threads, sizeof(MailWorker*));
+    if (!pool.workers) return total;
+    int ready = 0;
+    while (ready < threads) {
+        MailWorker* w = nn_aligned_alloc(sizeof(MailWorker));
+        if (!w) break;
+        memset(w, 0, sizeof(MailWorker));
+        pthread_mutex_init(&w->lock, NULL);
+        w->box = box;
+        w->pool = &pool;
+        w->index = ready;
+        pool.workers[ready++] = w;
+    }
+    pool.threads = threads = ready;
+    if (threads == 0) {
+        free(pool.workers);
+        return total;
+    }
+
+    // Equal contiguous shares, so neighbouring messages stay on one worker
+    for(int i = 0; i < threads; i++) {
+        pool.workers[i]->next = box->count * i / threads;
+        pool.workers[i]->end = box->count * (i + 1) / threads;
+    }
+
+    double start = wall_seconds();
+    int started = 1;  // Worker 0 is the calling thread
+    while (started < threads && pthread_create(&pool.workers[started]->thread, NULL, worker_main, pool.workers[started]) == 0) started++;
+    worker_main(pool.workers[0]);  // Also steals the share of any worker that failed to start
+    for(int i = 1; i < started; i++) pthread_join(pool.workers[i]->thread, NULL);
+    total.seconds = wall_seconds() - start;
+
+    total.threads = started;
+    for(int i = 0; i < threads; i++) {
+        MailWorker* w = pool.workers[i];
+        total.messages += w->stats.messages;
+        total.failed += w->stats.failed;
+        total.bytes += w->stats.bytes;
+        total.steals += w->stats.steals;
+        pthread_mutex_destroy(&w->lock);
+        nn_aligned_free(w);
+    }
+    free(pool.workers);
+    return total;
+}
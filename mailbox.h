@@ -0,0 +1,58 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stddef.h>
+
+// Mail archives for bulk scans: an mbox file (mapped and split on its
+// "From " lines) or a Maildir directory (the files in new/ and cur/, or in
+// the directory itself when it has neither). Messages are numbered in archive
+// order: file order for mbox, name order for Maildir.
+typedef enum { MAILBOX_MBOX, MAILBOX_MAILDIR } MailboxFormat;
+
+typedef struct Mailbox Mailbox;
+
+// One message, headers and body. Reuse it from one read to the next: a
+// Maildir read keeps its buffer, an mbox read points into the mapping.
+typedef struct {
+    const char* data;
+    size_t length;
+    char* buffer;     // Maildir read buffer (free with mail_message_free)
+    size_t capacity;
+} MailMessage;
+
+// Messages before the next worker goes back to its queue
+#define MAILBOX_CHUNK 16
+
+// Called once per message by worker 'worker' (0 .. threads - 1). One worker
+// handles one message at a time, so state indexed by worker needs no lock.
+// 'msg' is NULL for a Maildir file that could not be read.
+typedef void (*MailVisitFn)(void* ctx, int worker, long index, const MailMessage* msg);
+
+typedef struct {
+    int threads;
+    long messages;       // Visited, unreadable ones included
+    long failed;         // Unreadable
+    unsigned long long bytes;
+    long steals;         // Work taken from another worker's queue
+    double seconds;      // Wall-clock time of the scan
+} MailboxScanStats;
+
+// --- Lifecycle ---
+Mailbox* open_mailbox(const char* path);  // NULL if missing or unreadable
+void close_mailbox(Mailbox* box);
+
+// --- Operations ---
+MailboxFormat mailbox_format(const Mailbox* box);
+long mailbox_count(const Mailbox* box);
+size_t mailbox_offset(const Mailbox* box, long index);     // mbox: byte offset of the "From " line
+const char* mailbox_file(const Mailbox* box, long index);  // Maildir: path inside the directory
+
+int mailbox_read(const Mailbox* box, long index, MailMessage* msg);  // 0 if unreadable
+void mail_message_free(MailMessage* msg);
+
+// Visits every message on a work-stealing pool: each worker starts with an
+// equal share of the archive and, once done, takes half of what is left of
+// another worker's share. threads <= 0: one per core.
+MailboxScanStats mailbox_scan(const Mailbox* box, int threads, MailVisitFn visit, void* ctx);
+
+#endif
@@ -4,7 +4,15 @@
 #include <math.h> 
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "nn.h"
+#include "nn_stats.h"
+#include "registry.h"
+#include "spam.h"
+#include "mailbox.h"
+#include "server.h"
+#include "learner.h"
 
 /* --- SYSTEM CONFIGURATION --- */
 #define CALC_SCALE 100.0
@@ -18,6 +26,12 @@
 #define SPAM_MAX_LINKS 5.0
 #define SPAM_MAX_CAPS 100.0 
 #define SPAM_MAX_KEYWORDS 3.0 
+#define TRAIN_BATCH 16                 // Samples per weight update
+#define TRAIN_RATE (0.1 * TRAIN_BATCH) // Mean-gradient step (= 0.1 per sample)
+#define BRAIN_CACHE_BYTES (64u << 20)  // Loaded brains kept in memory between visits
+
+// Brains stay loaded for the life of the process
+static NNRegistry* brains;
 
 /* --- UTILITIES --- */
 
@@ -30,16 +44,6 @@ void flush_input() {
     while ((c = getchar()) != '\n' && c != EOF);
 }
 
-// Check for persistent brain files
-int file_exists(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (file) {
-        fclose(file);
-        return 1;
-    }
-    return 0;
-}
-
 // Visual loading indicator
 void progress_bar(int current, int total, const char* label) {
     if (current % (total / 50) != 0) return; 
@@ -55,58 +59,300 @@ void progress_bar(int current, int total, const char* label) {
     fflush(stdout); 
 }
 
+// CORTEX_STATS=<file> turns the engine counters on and writes them at exit
+// (.json, .prom for a Prometheus textfile collector, anything else text)
+static const char* stats_path;
+
+static void stats_boot(void) {
+    stats_path = getenv("CORTEX_STATS");
+    if (stats_path && *stats_path) nn_stats_enable(1);
+}
+
+static void stats_dump(void) {
+    if (!stats_path || !*stats_path) return;
+    if (!nn_stats_export(stats_path)) fprintf(stderr, "Error: cannot write engine stats to '%s'.\n", stats_path);
+}
+
+/* --- BRAIN TRAINING --- */
+
+// Each brain draws its training data from its own generator, so brains can
+// train side by side on worker threads (rand() is not thread-safe)
+#define BRAIN_RAND_MAX 0x7fff
+
+static int brain_rand(unsigned* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (int)((*seed >> 16) & BRAIN_RAND_MAX);
+}
+
+// Fills one training example; 'i' is the iteration number
+typedef void (*SampleFn)(unsigned* seed, int i, double* inputs, double* target);
+
+static void sample_calc_diff(unsigned* seed, int i, double* inputs, double* target) {
+    (void)i;
+    int a = brain_rand(seed) % 101;
+    int b;
+    int strategy = brain_rand(seed) % 3;
+    if (strategy == 0) { b = a; target[0] = 0.0; } 
+    else if (strategy == 1) { b = (a + 1) % 101; target[0] = 1.0; } 
+    else { b = brain_rand(seed) % 101; if (b == a) b = (b + 1) % 101; target[0] = 1.0; }
+
+    inputs[0] = (double)a / CALC_SCALE;
+    inputs[1] = (double)b / CALC_SCALE;
+    inputs[2] = fabs(inputs[0] - inputs[1]) * CALC_AMP; 
+}
+
+static void sample_calc_add(unsigned* seed, int i, double* inputs, double* target) {
+    (void)i;
+    double a = (double)(brain_rand(seed) % 11); 
+    double b = (double)(brain_rand(seed) % 11); 
+    double sum = a + b; 
+    inputs[0] = a / 20.0; inputs[1] = b / 20.0; target[0] = sum / 20.0; 
+}
+
+static void sample_doctor(unsigned* seed, int i, double* inputs, double* target) {
+    double temp, hr, o2;
+    int condition = 0;
+
+    if (i % 2 == 0) {
+        // GENERATE HEALTHY PATIENT
+        temp = 97.0 + ((double)brain_rand(seed) / BRAIN_RAND_MAX * 2.0); // 97-99 F
+        hr   = 60.0 + ((double)brain_rand(seed) / BRAIN_RAND_MAX * 40.0); // 60-100 BPM
+        o2   = 95.0 + ((double)brain_rand(seed) / BRAIN_RAND_MAX * 5.0);  // 95-100 %
+        condition = 0; // Safe
+    } else {
+        // GENERATE RANDOM/SICK PATIENT
+        temp = 95.0 + ((double)brain_rand(seed) / BRAIN_RAND_MAX * 12.0);
+        hr   = 0.0 + ((double)brain_rand(seed) / BRAIN_RAND_MAX * 200.0);
+        o2   = 70.0 + ((double)brain_rand(seed) / BRAIN_RAND_MAX * 30.0);
+        
+        // Classify the random patient
+        if (hr < 30.0) condition = 2;       
+        else if (o2 < 90.0) condition = 2;  
+        else if (o2 < 95.0) condition = 1;
+        else if (temp > 104.0 || temp < 95.0) condition = 2; 
+        else if (temp > 100.4) condition = 1;
+        else if (hr > 120.0 || hr < 50.0) condition = 1; 
+        if (hr > 110.0 && temp > 101.0) condition = 2; 
+        if (hr > 120.0 && temp < 97.0) condition = 2;
+    }
+
+    target[0] = (double)condition / 2.0;
+    inputs[0] = temp / MED_MAX_TEMP; inputs[1] = hr / MED_MAX_HR; inputs[2] = o2 / MED_MAX_O2;
+}
+
+static void sample_fitness(unsigned* seed, int i, double* inputs, double* target) {
+    (void)i;
+    double weight = 40.0 + (brain_rand(seed) % 100);
+    double height = 140.0 + (brain_rand(seed) % 70);
+    double cals = 1200 + (brain_rand(seed) % 2800);
+    
+    double h_m = height / 100.0;
+    double bmi = weight / (h_m * h_m);
+    
+    if (bmi < 18.5) target[0] = 0.0;      
+    else if (bmi > 25.0) target[0] = 1.0; 
+    else target[0] = 0.5;                 
+
+    inputs[0] = weight / FIT_MAX_WEIGHT; 
+    inputs[1] = height / FIT_MAX_HEIGHT; 
+    inputs[2] = cals / FIT_MAX_CALS;
+}
+
+static void sample_spam(unsigned* seed, int i, double* inputs, double* target) {
+    (void)i;
+    double links = brain_rand(seed) % 6;       
+    double caps = brain_rand(seed) % 101;      
+    double keywords = brain_rand(seed) % 6;    
+    
+    double risk_score = 0;
+    risk_score += (links * 15.0);        
+    risk_score += (keywords * 20.0);     
+    if (caps > 50.0) risk_score += (caps * 0.5); 
+    
+    int is_spam = (risk_score > 50.0) ? 1 : 0;
+    target[0] = (double)is_spam;
+    inputs[0] = links/SPAM_MAX_LINKS; 
+    inputs[1] = caps/SPAM_MAX_CAPS; 
+    inputs[2] = keywords/SPAM_MAX_KEYWORDS;
+}
+
+typedef enum { BRAIN_CALC_DIFF, BRAIN_CALC_ADD, BRAIN_DOC, BRAIN_FIT, BRAIN_SPAM, BRAIN_COUNT } BrainId;
+
+typedef struct {
+    const char* file;
+    const char* title;  // Shown when loading or waiting
+    const char* label;  // Progress bar label
+    int inputs;
+    int iterations;
+    SampleFn sample;
+} BrainSpec;
+
+static const BrainSpec BRAINS[BRAIN_COUNT] = {
+    { "brain_calc_diff.dat", "Precision Brain", "Training Precision", 3, 80000, sample_calc_diff },
+    { "brain_calc_add.dat",  "Adder Brain",     "Training Adder    ", 2, 40000, sample_calc_add },
+    { "brain_doc_v4.dat",    "Medical Brain",   "Studying Cases   ",  3, 80000, sample_doctor },
+    { "brain_fit_v2.dat",    "Fitness Brain",   "Calibrating      ",  3, 80000, sample_fitness },
+    { "brain_spam_v2.dat",   "Security Brain",  "Learning Nuance  ",  3, 80000, sample_spam },
+};
+
+// Background training of one brain, a future the apps can wait on
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int started;
+    int running;
+    int progress;  // Iterations done, updated every 2%
+    unsigned seed;
+} BrainJob;
+
+static BrainJob jobs[BRAIN_COUNT];
+
+// Trains a brain from scratch, saves it and publishes it to the registry.
+// With a job the progress goes to its waiters, otherwise to the console.
+// A batch of these tiny networks is far below TRAINER_MIN_SHARD_MACS, so it
+// runs on this thread; cold start gets its parallelism from training the
+// brains side by side (boot_brains). NULL when out of memory.
+static const NeuralNetwork* train_brain(BrainId id, unsigned seed, BrainJob* job) {
+    const BrainSpec* spec = &BRAINS[id];
+    NeuralNetwork* fresh = create_network(spec->inputs, 8, 1);
+    NNWorkspace* ws = fresh ? create_workspace(fresh) : NULL;
+    if (!ws) {
+        fprintf(stderr, "Error: not enough memory to train %s.\n", spec->title);
+        free_network(fresh);
+        return NULL;
+    }
+    double batch_inputs[TRAIN_BATCH * 3], batch_targets[TRAIN_BATCH];
+    int filled = 0;
+    int step = spec->iterations / 50;
+
+    for(int i=0; i<spec->iterations; i++) {
+        if (i % step == 0) {
+            if (job) {
+                pthread_mutex_lock(&job->lock);
+                job->progress = i;
+                pthread_cond_broadcast(&job->changed);
+                pthread_mutex_unlock(&job->lock);
+            } else {
+                progress_bar(i, spec->iterations, spec->label);
+            }
+        }
+        spec->sample(&seed, i, &batch_inputs[filled * spec->inputs], &batch_targets[filled]);
+        if (++filled == TRAIN_BATCH) {
+            train_batch(fresh, ws, batch_inputs, batch_targets, filled, TRAIN_RATE);
+            filled = 0;
+        }
+    }
+    if (filled) train_batch(fresh, ws, batch_inputs, batch_targets, filled, TRAIN_RATE);
+    free_workspace(ws);
+    if (!job) printf("\n>> Saving '%s'...\n", spec->file);
+    save_network(fresh, spec->file);
+    return registry_publish(brains, spec->file, fresh);
+}
+
+static void* brain_job_main(void* arg) {
+    BrainJob* job = arg;
+    BrainId id = (BrainId)(job - jobs);
+    registry_release(brains, train_brain(id, job->seed, job));
+
+    pthread_mutex_lock(&job->lock);
+    job->running = 0;
+    pthread_cond_broadcast(&job->changed);
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+// Boot: load the brains on disk and, with 'background', start training every
+// missing one at once, one thread each
+static void boot_brains(int background) {
+    int missing[BRAIN_COUNT], count = 0;
+    for(int id = 0; id < BRAIN_COUNT; id++) {
+        pthread_mutex_init(&jobs[id].lock, NULL);
+        pthread_cond_init(&jobs[id].changed, NULL);
+        if (!background) continue;
+        const NeuralNetwork* nn = registry_acquire(brains, BRAINS[id].file);
+        if (nn) registry_release(brains, nn);  // Stays cached
+        else missing[count++] = id;
+    }
+    if (count == 0) return;
+
+    printf(">> Pre-training %d brain(s) in the background...\n", count);
+    for(int k = 0; k < count; k++) {
+        BrainJob* job = &jobs[missing[k]];
+        job->seed = (unsigned)rand();
+        job->running = 1;
+        job->started = pthread_create(&job->thread, NULL, brain_job_main, job) == 0;
+        if (!job->started) job->running = 0;
+    }
+}
+
+// Wait for any background training still running (its files get written)
+static void join_brains(void) {
+    for(int id = 0; id < BRAIN_COUNT; id++) {
+        if (jobs[id].started) pthread_join(jobs[id].thread, NULL);
+        pthread_mutex_destroy(&jobs[id].lock);
+        pthread_cond_destroy(&jobs[id].changed);
+    }
+}
+
+// Shared reference to a brain: waits for its background training if still
+// running, and trains it on the spot if it is neither on disk nor in memory.
+// NULL if that training fails.
+static const NeuralNetwork* acquire_brain(BrainId id) {
+    const BrainSpec* spec = &BRAINS[id];
+    BrainJob* job = &jobs[id];
+
+    pthread_mutex_lock(&job->lock);
+    if (job->running) {
+        printf(">> %s is still training. Please wait...\n", spec->title);
+        while (job->running) {
+            progress_bar(job->progress, spec->iterations, spec->label);
+            pthread_cond_wait(&job->changed, &job->lock);
+        }
+        printf("\n");
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    const NeuralNetwork* nn = registry_acquire(brains, spec->file);
+    if (nn) {
+        printf(">> %s ready.\n", spec->title);
+        return nn;
+    }
+    printf(">> Training %s...\n", spec->title);
+    return train_brain(id, (unsigned)rand(), NULL);
+}
+
+// acquire_brain plus a workspace for an interactive app. On failure it
+// reports the brain as unavailable, holds nothing and returns 0.
+static int open_brain(BrainId id, const NeuralNetwork** nn, NNWorkspace** ws) {
+    *nn = acquire_brain(id);
+    *ws = *nn ? create_workspace(*nn) : NULL;
+    if (*ws) return 1;
+    fprintf(stderr, "Error: %s is unavailable.\n", BRAINS[id].title);
+    registry_release(brains, *nn);
+    *nn = NULL;
+    return 0;
+}
+
 /* =============================================================
    APP 1: NEURO-CALC
    Precision Difference Engine & Neural Adder
    ============================================================= */
 void app_calculator() {
-    NeuralNetwork* nn_diff = NULL;
-    NeuralNetwork* nn_add = NULL;
+    const NeuralNetwork* nn_diff = NULL;
+    const NeuralNetwork* nn_add = NULL;
 
     printf("\n[ NEURO-CALC: INITIALIZING SYSTEM ]\n");
 
-    // Load or Train: Difference Engine
-    if (file_exists("brain_calc_diff.dat")) {
-        printf(">> Precision Brain found. Loading...\n");
-        nn_diff = load_network("brain_calc_diff.dat");
-    } else {
-        nn_diff = create_network(3, 8, 1);
-        for(int i=0; i<80000; i++) {
-            progress_bar(i, 80000, "Training Precision");
-            double inputs[3], target[1];
-            int a = rand() % 101;
-            int b;
-            int strategy = rand() % 3;
-            if (strategy == 0) { b = a; target[0] = 0.0; } 
-            else if (strategy == 1) { b = (a + 1) % 101; target[0] = 1.0; } 
-            else { b = rand() % 101; if (b == a) b = (b + 1) % 101; target[0] = 1.0; }
-
-            inputs[0] = (double)a / CALC_SCALE;
-            inputs[1] = (double)b / CALC_SCALE;
-            inputs[2] = fabs(inputs[0] - inputs[1]) * CALC_AMP; 
-            train(nn_diff, inputs, target, 0.1);
-        }
-        printf("\n>> Saving 'brain_calc_diff.dat'...\n");
-        save_network(nn_diff, "brain_calc_diff.dat");
-    }
-
-    // Load or Train: Neural Adder
-    if (file_exists("brain_calc_add.dat")) {
-        printf(">> Adder Brain found. Loading...\n");
-        nn_add = load_network("brain_calc_add.dat");
-    } else {
-        nn_add = create_network(2, 8, 1);
-        for(int i=0; i<40000; i++) {
-            progress_bar(i, 40000, "Training Adder    ");
-            double inputs[2], target[1];
-            double a = (double)(rand() % 11); 
-            double b = (double)(rand() % 11); 
-            double sum = a + b; 
-            inputs[0] = a / 20.0; inputs[1] = b / 20.0; target[0] = sum / 20.0; 
-            train(nn_add, inputs, target, 0.1);
-        }
-        printf("\n>> Saving 'brain_calc_add.dat'...\n");
-        save_network(nn_add, "brain_calc_add.dat");
+    // Load or Train: Difference Engine and Neural Adder, each with the
+    // scratch space reused by every query
+    NNWorkspace* ws_diff = NULL;
+    NNWorkspace* ws_add = NULL;
+    if (!open_brain(BRAIN_CALC_DIFF, &nn_diff, &ws_diff)) return;
+    if (!open_brain(BRAIN_CALC_ADD, &nn_add, &ws_add)) {
+        free_workspace(ws_diff);
+        registry_release(brains, nn_diff);
+        return;
     }
 
     // Calc Interface
@@ -138,7 +384,8 @@ void app_calculator() {
                 double n2 = in2 / CALC_SCALE;
                 double diff = fabs(n1 - n2) * CALC_AMP;
                 double input[3] = {n1, n2, diff};
-                double* res = predict(nn_diff, input);
+                double res[1];
+                predict_into(nn_diff, ws_diff, input, res);
                 printf(">> Verdict: %s (Confidence: %.1f%%)\n", res[0] > 0.8 ? "DIFFERENT" : "SAME", res[0]*100);
             }
         }
@@ -153,7 +400,8 @@ void app_calculator() {
                 if (a == -1) break;
                 scanf("%lf", &b);
                 double input[2] = {a/20.0, b/20.0};
-                double* res = predict(nn_add, input);
+                double res[1];
+                predict_into(nn_add, ws_add, input, res);
                 printf(">> AI Estimate: %.2f (Actual: %.0f)\n", res[0] * 20.0, a+b);
                 
                 if (first_run) {
@@ -178,62 +426,76 @@ void app_calculator() {
             }
         }
     }
-    if(nn_diff) free(nn_diff);
-    if(nn_add) free(nn_add);
+    free_workspace(ws_diff);
+    free_workspace(ws_add);
+    registry_release(brains, nn_diff);
+    registry_release(brains, nn_add);
 }
 
 // =============================================================
 // APP 2: DOC-AI (v4.0 - Balanced Logic & Explainability)
 // =============================================================
-void app_doctor() {
-    NeuralNetwork* nn = NULL;
-    printf("\n[ LOADING DOC-AI (v4.0)... ]\n");
-    
-    if (file_exists("brain_doc_v4.dat")) {
-        printf(">> Medical Brain found. Loading instantly...\n");
-        nn = load_network("brain_doc_v4.dat");
-    } else {
-        printf(">> Training Balanced Medical Logic...\n");
-        nn = create_network(3, 8, 1);
-        
-        for(int i=0; i<80000; i++) {
-            progress_bar(i, 80000, "Studying Cases   ");
-            double inputs[3], target[1];
-            
-            double temp, hr, o2;
-            int condition = 0;
 
-            
-            if (i % 2 == 0) {
-                // GENERATE HEALTHY PATIENT
-                temp = 97.0 + ((double)rand() / RAND_MAX * 2.0); // 97-99 F
-                hr   = 60.0 + ((double)rand() / RAND_MAX * 40.0); // 60-100 BPM
-                o2   = 95.0 + ((double)rand() / RAND_MAX * 5.0);  // 95-100 %
-                condition = 0; // Safe
-            } else {
-                // GENERATE RANDOM/SICK PATIENT
-                temp = 95.0 + ((double)rand() / RAND_MAX * 12.0);
-                hr   = 0.0 + ((double)rand() / RAND_MAX * 200.0);
-                o2   = 70.0 + ((double)rand() / RAND_MAX * 30.0);
-                
-                // Classify the random patient
-                if (hr < 30.0) condition = 2;       
-                else if (o2 < 90.0) condition = 2;  
-                else if (o2 < 95.0) condition = 1;
-                else if (temp > 104.0 || temp < 95.0) condition = 2; 
-                else if (temp > 100.4) condition = 1;
-                else if (hr > 120.0 || hr < 50.0) condition = 1; 
-                if (hr > 110.0 && temp > 101.0) condition = 2; 
-                if (hr > 120.0 && temp < 97.0) condition = 2;
-            }
+// --- TRIAGE RULES (shared by the interactive and headless modes) ---
+typedef enum { TEMP_AS_GIVEN, TEMP_CONVERTED, TEMP_ASSUMED_F, TEMP_ASSUMED_C } TempReading;
 
-            target[0] = (double)condition / 2.0;
-            inputs[0] = temp / MED_MAX_TEMP; inputs[1] = hr / MED_MAX_HR; inputs[2] = o2 / MED_MAX_O2;
-            train(nn, inputs, target, 0.1);
-        }
-        printf("\n>> Saving 'brain_doc_v4.dat'...\n");
-        save_network(nn, "brain_doc_v4.dat");
+// Temperature in the selected unit -> Fahrenheit, overriding implausible units
+static double doc_fahrenheit(double t_in, int celsius, TempReading* reading) {
+    if (celsius) {
+        if (t_in > 60.0) { *reading = TEMP_ASSUMED_F; return t_in; }
+        *reading = TEMP_CONVERTED;
+        return (t_in * 9.0/5.0) + 32.0;
     }
+    if (t_in < 50.0) { *reading = TEMP_ASSUMED_C; return (t_in * 9.0/5.0) + 32.0; }
+    *reading = TEMP_AS_GIVEN;
+    return t_in;
+}
+
+// Explainability engine (the "Why"): one finding per vital, returns the issue count
+static int doc_findings(double temp_f, double hr, double o2, const char* findings[3]) {
+    int issues_found = 0;
+
+    // 1. OXYGEN ANALYSIS
+    if (o2 <= 0) { findings[0] = "[CRITICAL] No Oxygen detected."; issues_found++; }
+    else if (o2 < 90.0) { findings[0] = "[CRITICAL] Hypoxia (Low Oxygen)."; issues_found++; }
+    else if (o2 < 95.0) { findings[0] = "[WARNING]  Oxygen is slightly low."; issues_found++; }
+    else findings[0] = "[  OK   ]  Oxygen levels normal.";
+
+    // 2. HEART ANALYSIS
+    if (hr <= 0) { findings[1] = "[CRITICAL] No Pulse."; issues_found++; }
+    else if (hr < 50.0) { findings[1] = "[WARNING]  Bradycardia (Low Heart Rate)."; issues_found++; }
+    else if (hr > 120.0) { findings[1] = "[WARNING]  Tachycardia (High Heart Rate)."; issues_found++; }
+    else findings[1] = "[  OK   ]  Heart Rate normal.";
+
+    // 3. TEMP ANALYSIS
+    if (temp_f > 103.0) { findings[2] = "[CRITICAL] Severe Fever."; issues_found++; }
+    else if (temp_f > 100.4) { findings[2] = "[WARNING]  Mild Fever."; issues_found++; }
+    else if (temp_f < 95.0) { findings[2] = "[CRITICAL] Hypothermia."; issues_found++; }
+    else findings[2] = "[  OK   ]  Temperature normal.";
+
+    return issues_found;
+}
+
+typedef struct {
+    const char* status;
+    const char* action;
+} DocVerdict;
+
+// Final verdict from the AI risk (%) and the rule findings
+static DocVerdict doc_verdict(double risk, int issues_found) {
+    DocVerdict v;
+    if (risk > 75.0 || issues_found >= 2) { v.status = "[!!!] CRITICAL CONDITION"; v.action = "CALL EMERGENCY SERVICES."; }
+    else if (risk > 35.0 || issues_found > 0) { v.status = "[ ! ] WARNING / ABNORMAL"; v.action = "Monitor closely."; }
+    else { v.status = "[ OK ] STABLE"; v.action = "Patient is healthy."; }
+    return v;
+}
+
+void app_doctor() {
+    const NeuralNetwork* nn = NULL;
+    printf("\n[ LOADING DOC-AI (v4.0)... ]\n");
+    
+    NNWorkspace* ws = NULL;
+    if (!open_brain(BRAIN_DOC, &nn, &ws)) return;
 
     printf("\n--- DOC-AI DIAGNOSTICS ---\n");
     int unit_choice = 0;
@@ -241,7 +503,12 @@ void app_doctor() {
     printf("[1] Fahrenheit (F)\n");
     printf("[2] Celsius (C)\n");
     printf("Select > ");
-    if (scanf("%d", &unit_choice) != 1) { flush_input(); return; }
+    if (scanf("%d", &unit_choice) != 1) {
+        flush_input();
+        free_workspace(ws);
+        registry_release(brains, nn);
+        return;
+    }
 
     printf("\nINSTRUCTIONS: Enter Temp, Heart Rate, Oxygen %%.\n");
     
@@ -253,99 +520,92 @@ void app_doctor() {
         scanf("%lf %lf", &hr, &o2);
 
         // --- SAFETY CHECKS & UNIT CONVERSION ---
-        double temp_f = t_in;
-        if (unit_choice == 2) { 
-            if (t_in > 60.0) { printf("   [!] ALERT: Boiling Temp. Assuming F.\n"); temp_f = t_in; } 
-            else { temp_f = (t_in * 9.0/5.0) + 32.0; printf("   (Converted %.1fC -> %.1fF)\n", t_in, temp_f); }
-        } else {
-            if (t_in < 50.0) { printf("   [!] ALERT: Frozen Temp. Assuming C.\n"); temp_f = (t_in * 9.0/5.0) + 32.0; printf("   (Auto-Corrected to %.1fF)\n", temp_f); }
-        }
+        TempReading reading;
+        double temp_f = doc_fahrenheit(t_in, unit_choice == 2, &reading);
+        if (reading == TEMP_ASSUMED_F) printf("   [!] ALERT: Boiling Temp. Assuming F.\n");
+        else if (reading == TEMP_CONVERTED) printf("   (Converted %.1fC -> %.1fF)\n", t_in, temp_f);
+        else if (reading == TEMP_ASSUMED_C) { printf("   [!] ALERT: Frozen Temp. Assuming C.\n"); printf("   (Auto-Corrected to %.1fF)\n", temp_f); }
         
         if (o2 > 100.0) o2 = 100.0; // Clamp oxygen
 
         // --- AI PREDICTION ---
         double input[3] = {temp_f/MED_MAX_TEMP, hr/MED_MAX_HR, o2/MED_MAX_O2};
-        double* res = predict(nn, input);
+        double res[1];
+        predict_into(nn, ws, input, res);
         double risk = res[0] * 100.0;
 
         printf("   AI Risk Analysis: %.1f%%\n", risk);
 
         // --- EXPLAINABILITY ENGINE (The "Why") ---
-        int issues_found = 0;
-        
-        // 1. OXYGEN ANALYSIS
-        if (o2 <= 0) { printf("   > [CRITICAL] No Oxygen detected.\n"); issues_found++; }
-        else if (o2 < 90.0) { printf("   > [CRITICAL] Hypoxia (Low Oxygen).\n"); issues_found++; }
-        else if (o2 < 95.0) { printf("   > [WARNING]  Oxygen is slightly low.\n"); issues_found++; }
-        else printf("   > [  OK   ]  Oxygen levels normal.\n");
-
-        // 2. HEART ANALYSIS
-        if (hr <= 0) { printf("   > [CRITICAL] No Pulse.\n"); issues_found++; }
-        else if (hr < 50.0) { printf("   > [WARNING]  Bradycardia (Low Heart Rate).\n"); issues_found++; }
-        else if (hr > 120.0) { printf("   > [WARNING]  Tachycardia (High Heart Rate).\n"); issues_found++; }
-        else printf("   > [  OK   ]  Heart Rate normal.\n");
-
-        // 3. TEMP ANALYSIS
-        if (temp_f > 103.0) { printf("   > [CRITICAL] Severe Fever.\n"); issues_found++; }
-        else if (temp_f > 100.4) { printf("   > [WARNING]  Mild Fever.\n"); issues_found++; }
-        else if (temp_f < 95.0) { printf("   > [CRITICAL] Hypothermia.\n"); issues_found++; }
-        else printf("   > [  OK   ]  Temperature normal.\n");
+        const char* findings[3];
+        int issues_found = doc_findings(temp_f, hr, o2, findings);
+        for(int f = 0; f < 3; f++) printf("   > %s\n", findings[f]);
 
         // --- FINAL VERDICT ---
+        DocVerdict verdict = doc_verdict(risk, issues_found);
         printf("   -----------------------------\n");
-        printf("   >> STATUS: ");
-        if (risk > 75.0 || issues_found >= 2) {
-            printf("[!!!] CRITICAL CONDITION\n");
-            printf("   >> ACTION: CALL EMERGENCY SERVICES.\n");
-        }
-        else if (risk > 35.0 || issues_found > 0) {
-            printf("[ ! ] WARNING / ABNORMAL\n");
-            printf("   >> ACTION: Monitor closely.\n");
-        }
-        else {
-            printf("[ OK ] STABLE\n");
-            printf("   >> ACTION: Patient is healthy.\n");
-        }
+        printf("   >> STATUS: %s\n", verdict.status);
+        printf("   >> ACTION: %s\n", verdict.action);
     }
-    if(nn) free(nn);
+    free_workspace(ws);
+    registry_release(brains, nn);
 }
 
 /* =============================================================
    APP 3: FIT-BOT (v2.1)
    Metabolic Analysis & TDEE Calculator
    ============================================================= */
+
+// --- METABOLIC RULES (shared by the interactive and headless modes) ---
+typedef struct {
+    double bmi;
+    double ideal_w;
+    double weight_diff;       // Current - ideal (kg)
+    double maintenance_cals;  // TDEE (kcal/day)
+    double calorie_diff;      // Intake - maintenance
+} FitReport;
+
+static FitReport fit_report(double w, double h, double c) {
+    FitReport r;
+    double h_m = h / 100.0;
+    r.bmi = w / (h_m * h_m);
+    r.ideal_w = 22.0 * (h_m * h_m);
+    r.weight_diff = w - r.ideal_w;
+    double bmr = (10.0 * w) + (6.25 * h) - (5.0 * 25.0) + 5.0;
+    r.maintenance_cals = bmr * 1.2; 
+    r.calorie_diff = c - r.maintenance_cals;
+    return r;
+}
+
+static const char* fit_bmi_class(double bmi) {
+    if (bmi < 18.5) return "Underweight";
+    if (bmi < 25.0) return "Healthy";
+    if (bmi < 30.0) return "Overweight";
+    return "Obese";
+}
+
+static const char* fit_intake_class(double calorie_diff) {
+    if (calorie_diff < -500) return "Starvation Zone [!]";
+    if (calorie_diff < 0) return "Deficit";
+    if (calorie_diff > 500) return "Surplus [!]";
+    return "Maintenance";
+}
+
+typedef enum { FIT_BULK, FIT_CUT, FIT_OPTIMAL } FitPlan;
+
+// AI verdict from the network score
+static FitPlan fit_plan(double score) {
+    if (score < 0.3) return FIT_BULK;
+    if (score > 0.7) return FIT_CUT;
+    return FIT_OPTIMAL;
+}
+
 void app_fitness_ai() {
-    NeuralNetwork* nn = NULL;
+    const NeuralNetwork* nn = NULL;
     printf("\n[ LOADING FIT-BOT (v2.1)... ]\n");
     
-    if (file_exists("brain_fit_v2.dat")) {
-        printf(">> Fitness Brain found. Loading...\n");
-        nn = load_network("brain_fit_v2.dat");
-    } else {
-        printf(">> Training Metabolic Logic...\n");
-        nn = create_network(3, 8, 1);
-        for(int i=0; i<80000; i++) {
-            progress_bar(i, 80000, "Calibrating      ");
-            double inputs[3], target[1];
-            double weight = 40.0 + (rand() % 100);
-            double height = 140.0 + (rand() % 70);
-            double cals = 1200 + (rand() % 2800);
-            
-            double h_m = height / 100.0;
-            double bmi = weight / (h_m * h_m);
-            
-            if (bmi < 18.5) target[0] = 0.0;      
-            else if (bmi > 25.0) target[0] = 1.0; 
-            else target[0] = 0.5;                 
-
-            inputs[0] = weight / FIT_MAX_WEIGHT; 
-            inputs[1] = height / FIT_MAX_HEIGHT; 
-            inputs[2] = cals / FIT_MAX_CALS;
-            train(nn, inputs, target, 0.1);
-        }
-        printf("\n>> Saving 'brain_fit_v2.dat'...\n");
-        save_network(nn, "brain_fit_v2.dat");
-    }
+    NNWorkspace* ws = NULL;
+    if (!open_brain(BRAIN_FIT, &nn, &ws)) return;
 
     printf("\n--- FIT-BOT PLANNER ---\n");
     printf("INSTRUCTIONS: Enter Weight(kg), Height(cm), Daily Calories.\n");
@@ -371,97 +631,75 @@ void app_fitness_ai() {
             printf("   [!] WARNING: %.0f kg is dangerously high.\n", w);
         }
 
-        double h_m = h / 100.0;
-        double bmi = w / (h_m * h_m);
-        double ideal_w = 22.0 * (h_m * h_m);
-        double weight_diff = w - ideal_w;
-        double bmr = (10.0 * w) + (6.25 * h) - (5.0 * 25.0) + 5.0;
-        double maintenance_cals = bmr * 1.2; 
-        double calorie_diff = c - maintenance_cals;
+        FitReport report = fit_report(w, h, c);
 
         double input[3] = {w/FIT_MAX_WEIGHT, h/FIT_MAX_HEIGHT, c/FIT_MAX_CALS};
-        double* res = predict(nn, input);
+        double res[1];
+        predict_into(nn, ws, input, res);
         double score = res[0];
 
         printf("--------------------------------------------------\n");
         printf(">> MEDICAL REPORT:\n");
-        printf("   BMI:           %.1f ", bmi);
-        
-        if (bmi < 18.5) printf("(Underweight)\n");
-        else if (bmi < 25.0) printf("(Healthy)\n");
-        else if (bmi < 30.0) printf("(Overweight)\n");
-        else printf("(Obese)\n");
+        printf("   BMI:           %.1f (%s)\n", report.bmi, fit_bmi_class(report.bmi));
 
-        printf("   Ideal Weight:  %.1f kg ", ideal_w);
-        if (weight_diff > 0) printf("(Lose %.1f kg)\n", weight_diff);
-        else printf("(Gain %.1f kg)\n", fabs(weight_diff));
+        printf("   Ideal Weight:  %.1f kg ", report.ideal_w);
+        if (report.weight_diff > 0) printf("(Lose %.1f kg)\n", report.weight_diff);
+        else printf("(Gain %.1f kg)\n", fabs(report.weight_diff));
 
-        printf("   Maintenance:   %.0f kcal/day\n", maintenance_cals);
-        printf("   Your Intake:   %.0f kcal/day ", c);
-
-        if (calorie_diff < -500) printf("(Starvation Zone [!])\n");
-        else if (calorie_diff < 0) printf("(Deficit)\n");
-        else if (calorie_diff > 500) printf("(Surplus [!])\n");
-        else printf("(Maintenance)\n");
+        printf("   Maintenance:   %.0f kcal/day\n", report.maintenance_cals);
+        printf("   Your Intake:   %.0f kcal/day (%s)\n", c, fit_intake_class(report.calorie_diff));
 
         printf("--------------------------------------------------\n");
         printf(">> AI VERDICT: ");
 
-        if (score < 0.3) {
+        FitPlan plan = fit_plan(score);
+        if (plan == FIT_BULK) {
             printf("BULK NEEDED.\n");
-            printf("   You are undereating by %.0f kcal.\n", fabs(calorie_diff));
-            printf("   PLAN: Eat %.0f kcal (+500 surplus). Focus on Protein.\n", maintenance_cals + 500);
+            printf("   You are undereating by %.0f kcal.\n", fabs(report.calorie_diff));
+            printf("   PLAN: Eat %.0f kcal (+500 surplus). Focus on Protein.\n", report.maintenance_cals + 500);
         } 
-        else if (score > 0.7) {
+        else if (plan == FIT_CUT) {
             printf("CUT NEEDED.\n");
             printf("   You are overeating for your height.\n");
-            printf("   PLAN: Target %.0f kcal (-500 deficit). 30min Cardio daily.\n", maintenance_cals - 500);
+            printf("   PLAN: Target %.0f kcal (-500 deficit). 30min Cardio daily.\n", report.maintenance_cals - 500);
         } 
         else {
             printf("OPTIMAL HEALTH.\n");
             printf("   PLAN: Keep doing what you are doing!\n");
         }
     }
-    if(nn) free(nn);
+    free_workspace(ws);
+    registry_release(brains, nn);
 }
 
 /* =============================================================
    APP 4: SPAM-GUARD
    Batch Context Processor with Weighted Risk Logic
    ============================================================= */
+
+// --- RISK FEATURES (shared by the interactive and headless modes) ---
+// Compiled once from SPAM_DEFAULT_PATTERNS at boot
+static SpamMatcher* spam_matcher;
+
+// Emails are scanned as they arrive, one line at a time. Each line break is
+// fed as a space, the layout the network was trained on.
+static void spam_feed_line(SpamStream* scan, const char* line, size_t length, int complete) {
+    spam_stream_feed(scan, line, length);
+    if (complete) spam_stream_feed(scan, " ", 1);
+}
+
+static const char* spam_verdict(double p) {
+    if (p > 0.8) return "[!!!] SPAM DETECTED";
+    if (p > 0.4) return "[ ? ] SUSPICIOUS";
+    return "[ OK ] SAFE";
+}
+
 void app_spam_filter() {
-    NeuralNetwork* nn = NULL;
+    const NeuralNetwork* nn = NULL;
     printf("\n[ LOADING SPAM-GUARD (BATCH PROCESSOR)... ]\n");
     
-    if (file_exists("brain_spam_v2.dat")) {
-        printf(">> Security Brain found. Loading...\n");
-        nn = load_network("brain_spam_v2.dat");
-    } else {
-        printf(">> Training Logic Model...\n");
-        nn = create_network(3, 8, 1);
-        
-        for(int i=0; i<80000; i++) {
-            progress_bar(i, 80000, "Learning Nuance  ");
-            double inputs[3], target[1];
-            double links = rand() % 6;       
-            double caps = rand() % 101;      
-            double keywords = rand() % 6;    
-            
-            double risk_score = 0;
-            risk_score += (links * 15.0);        
-            risk_score += (keywords * 20.0);     
-            if (caps > 50.0) risk_score += (caps * 0.5); 
-            
-            int is_spam = (risk_score > 50.0) ? 1 : 0;
-            target[0] = (double)is_spam;
-            inputs[0] = links/SPAM_MAX_LINKS; 
-            inputs[1] = caps/SPAM_MAX_CAPS; 
-            inputs[2] = keywords/SPAM_MAX_KEYWORDS;
-            train(nn, inputs, target, 0.1);
-        }
-        printf("\n>> Saving 'brain_spam_v2.dat'...\n");
-        save_network(nn, "brain_spam_v2.dat");
-    }
+    NNWorkspace* ws = NULL;
+    if (!open_brain(BRAIN_SPAM, &nn, &ws)) return;
 
     printf("\n--- FULL-TEXT EMAIL SCANNER ---\n");
     printf("INSTRUCTIONS:\n");
@@ -470,78 +708,54 @@ void app_spam_filter() {
     printf("3. Type 'QUIT' to exit.\n");
     flush_input(); 
 
-    char full_email[10000] = ""; 
+    SpamStream scan;
     char line_buffer[256];
 
     while(1) {
-        strcpy(full_email, ""); 
+        spam_stream_begin(&scan, spam_matcher);
         printf("\n[ PASTE EMAIL BELOW -> TYPE 'END' WHEN DONE ]\n");
         printf("--------------------------------------------------\n");
 
+        // Long lines arrive in several pieces; only whole lines are commands
+        int line_start = 1;
         while(1) {
             if (fgets(line_buffer, 256, stdin) == NULL) break;
-            line_buffer[strcspn(line_buffer, "\n")] = 0;
+            size_t length = strlen(line_buffer);
+            int complete = length > 0 && line_buffer[length - 1] == '\n';
+            if (complete) line_buffer[--length] = 0;
 
-            if (strcmp(line_buffer, "END") == 0) break; 
-            if (strcmp(line_buffer, "QUIT") == 0) {
-                if(nn) free(nn);
-                printf(">> Exiting Spam-Guard. Stay secure.\n");
-                return; 
-            }
-
-            if (strlen(full_email) + strlen(line_buffer) < 9999) {
-                strcat(full_email, line_buffer);
-                strcat(full_email, " "); 
+            if (line_start && complete) {
+                if (strcmp(line_buffer, "END") == 0) break; 
+                if (strcmp(line_buffer, "QUIT") == 0) {
+                    free_workspace(ws);
+                    registry_release(brains, nn);
+                    printf(">> Exiting Spam-Guard. Stay secure.\n");
+                    return; 
+                }
             }
+            spam_feed_line(&scan, line_buffer, length, complete);
+            line_start = complete;
         }
 
-        if (strlen(full_email) < 2) continue;
+        SpamFeatures found;
+        spam_stream_end(&scan, &found);
+        if (found.length < 2) continue;
 
         printf("--------------------------------------------------\n");
         printf(">> SCANNING FULL CONTENT...\n");
 
-        int len = strlen(full_email);
-        int caps_count = 0;
-        for(int i=0; i<len; i++) {
-            if (isupper(full_email[i])) caps_count++;
-            full_email[i] = toupper(full_email[i]); 
-        }
-        
-        double caps = ((double)caps_count / len) * 100.0;
-        double links = 0; 
-        double keywords = 0;
-
-        char *ptr = full_email;
-        while ((ptr = strstr(ptr, "HTTP"))) { links++; ptr++; }
-        ptr = full_email;
-        while ((ptr = strstr(ptr, "WWW"))) { links++; ptr++; }
-        ptr = full_email;
-        while ((ptr = strstr(ptr, ".COM"))) { links++; ptr++; }
-
-        if (strstr(full_email, "FREE")) keywords++;
-        if (strstr(full_email, "WINNER")) keywords++;
-        if (strstr(full_email, "CASH")) keywords++;
-        if (strstr(full_email, "URGENT")) keywords++;
-        if (strstr(full_email, "CLICK")) keywords++;
-        if (strstr(full_email, "PRIORITY")) keywords++;
-        if (strstr(full_email, "OFFER")) keywords++;
-        if (strstr(full_email, "SELECTED")) keywords++;
-        if (strstr(full_email, "CREDIT")) keywords++;
-        if (strstr(full_email, "$")) keywords++;
-        if (strstr(full_email, "RISK")) keywords++;
-        if (strstr(full_email, "BANK")) keywords++;
+        double features[3];
+        spam_feature_vector(&found, features);
+        double links = features[0], caps = features[1], keywords = features[2];
 
         printf("   [Total Stats: %.0f Links, %.0f%% Caps, %.0f Keywords]\n", links, caps, keywords);
 
         double input[3] = {links/SPAM_MAX_LINKS, caps/SPAM_MAX_CAPS, keywords/SPAM_MAX_KEYWORDS};
-        double* res = predict(nn, input);
+        double res[1];
+        predict_into(nn, ws, input, res);
 
         double probability = res[0] * 100.0;
-        printf("   >> FINAL VERDICT: ");
-        
-        if (res[0] > 0.8) printf("[!!!] SPAM DETECTED (%.1f%%)\n", probability);
-        else if (res[0] > 0.4) printf("[ ? ] SUSPICIOUS (%.1f%%)\n", probability);
-        else printf("[ OK ] SAFE (%.1f%%)\n", probability);
+        printf("   >> FINAL VERDICT: %s (%.1f%%)\n", spam_verdict(res[0]), probability);
     }
 }
 
@@ -635,11 +849,701 @@ void app_guide() {
     }
 }
 
+/* =============================================================
+   HEADLESS MODE: BATCH FILE PROCESSING
+   Cortex --app doc|fit|spam --in <records> --out <results.csv> [--celsius]
+   ============================================================= */
+#define CLI_CHUNK (1 << 20)  // Bytes per read, and the output buffer size
+#define CLI_BATCH 1024       // Records per predict_batch call
+
+// Reads a file in large chunks and hands out one line at a time
+typedef struct {
+    FILE* file;
+    char* buf;
+    size_t cap;
+    size_t start, end;  // Unread bytes: buf[start..end)
+    int eof;
+    long line_no;   // Line of the last line or piece returned
+    int mid_line;   // The last piece did not end its line
+} LineReader;
+
+static int reader_open(LineReader* r, FILE* file) {
+    r->file = file;
+    r->cap = CLI_CHUNK;
+    r->buf = malloc(r->cap + 1);
+    r->start = r->end = 0;
+    r->eof = 0;
+    r->line_no = 0;
+    r->mid_line = 0;
+    return r->buf != NULL;
+}
+
+// Next line without its line ending, valid until the following call; NULL at the end
+static char* read_line(LineReader* r) {
+    while (1) {
+        char* line = r->buf + r->start;
+        char* nl = memchr(line, '\n', r->end - r->start);
+        if (nl || (r->eof && r->start < r->end)) {
+            char* stop = nl ? nl : r->buf + r->end;
+            r->start = nl ? (size_t)(nl - r->buf) + 1 : r->end;
+            if (stop > line && stop[-1] == '\r') stop--;
+            *stop = '\0';
+            r->line_no++;
+            return line;
+        }
+        if (r->eof) return NULL;
+
+        // Keep the partial line, growing the buffer if it fills it
+        memmove(r->buf, line, r->end - r->start);
+        r->end -= r->start;
+        r->start = 0;
+        if (r->end == r->cap) {
+            char* grown = realloc(r->buf, r->cap * 2 + 1);
+            if (!grown) return NULL;
+            r->buf = grown;
+            r->cap *= 2;
+        }
+        size_t got = fread(r->buf + r->end, 1, r->cap - r->end, r->file);
+        r->end += got;
+        if (got == 0) r->eof = 1;
+    }
+}
+
+// Like read_line, but a line longer than the buffer comes back in pieces, so
+// lines of any length pass through in constant memory. *complete is set when
+// the piece ends its line.
+static char* read_piece(LineReader* r, size_t* length, int* complete) {
+    while (1) {
+        char* piece = r->buf + r->start;
+        size_t avail = r->end - r->start;
+        char* nl = memchr(piece, '\n', avail);
+        if (nl || (r->eof && avail) || avail == r->cap) {
+            char* stop = nl ? nl : r->buf + r->end;
+            r->start = (size_t)(stop - r->buf) + (nl != NULL);
+            *complete = nl || r->eof;
+            if (*complete && stop > piece && stop[-1] == '\r') stop--;
+            *stop = '\0';
+            *length = (size_t)(stop - piece);
+            if (!r->mid_line) r->line_no++;
+            r->mid_line = !*complete;
+            return piece;
+        }
+        if (r->eof) return NULL;
+
+        memmove(r->buf, piece, avail);
+        r->end = avail;
+        r->start = 0;
+        size_t got = fread(r->buf + r->end, 1, r->cap - r->end, r->file);
+        r->end += got;
+        if (got == 0) r->eof = 1;
+    }
+}
+
+// Up to 'max' numbers separated by commas, semicolons or blanks; returns the count
+static int parse_numbers(const char* line, double* values, int max) {
+    int count = 0;
+    while (count < max) {
+        while (*line == ',' || *line == ';' || *line == ' ' || *line == '\t') line++;
+        if (!*line) break;
+        char* end;
+        values[count] = strtod(line, &end);
+        if (end == line) return -1;
+        line = end;
+        count++;
+    }
+    while (*line == ',' || *line == ';' || *line == ' ' || *line == '\t') line++;
+    return *line ? -1 : count;
+}
+
+// One headless app: turns input lines into records, and scored records into CSV rows.
+// 'raw' keeps what the report needs; raw[0] is the record's first input line.
+// 'parse' reads one record from a string (the server's requests), 'format'
+// writes the row after the line number.
+#define CLI_RAW 4
+#define CLI_ROW 512  // Longest formatted row
+
+typedef struct {
+    const char* name;
+    BrainId brain;
+    const char* header;
+    int (*next)(LineReader* in, double* raw, double* inputs);  // 0 at end of input
+    int (*parse)(const char* text, size_t length, double* raw, double* inputs);  // 0 if malformed
+    void (*format)(char* row, size_t size, const double* raw, double score);
+    double scale;  // Reported score = network output * scale (feedback labels use it too)
+} HeadlessApp;
+
+static int cli_celsius = 0;
+
+// Numeric records, one per line; a non-numeric first line is taken as a header
+static int next_numeric(LineReader* in, const char* expect, double* values, int count) {
+    char* line;
+    while ((line = read_line(in))) {
+        if (!*line || *line == '#') continue;
+        if (parse_numbers(line, values, count) == count) return 1;
+        if (in->line_no > 1) fprintf(stderr, "line %ld: skipped (expected %s)\n", in->line_no, expect);
+    }
+    return 0;
+}
+
+static void diff_record(const double* v, double* raw, double* inputs) {
+    double n1 = v[0] / CALC_SCALE;
+    double n2 = v[1] / CALC_SCALE;
+    raw[1] = v[0]; raw[2] = v[1];
+    inputs[0] = n1; inputs[1] = n2; inputs[2] = fabs(n1 - n2) * CALC_AMP;
+}
+
+static int diff_next(LineReader* in, double* raw, double* inputs) {
+    double v[2];
+    if (!next_numeric(in, "a,b", v, 2)) return 0;
+    raw[0] = in->line_no;
+    diff_record(v, raw, inputs);
+    return 1;
+}
+
+static int diff_parse(const char* text, size_t length, double* raw, double* inputs) {
+    double v[2];
+    (void)length;
+    if (parse_numbers(text, v, 2) != 2) return 0;
+    diff_record(v, raw, inputs);
+    return 1;
+}
+
+static void diff_format(char* row, size_t size, const double* raw, double score) {
+    snprintf(row, size, "%g,%g,%.1f,\"%s\"", raw[1], raw[2], score * 100, score > 0.8 ? "DIFFERENT" : "SAME");
+}
+
+static void add_record(const double* v, double* raw, double* inputs) {
+    raw[1] = v[0]; raw[2] = v[1];
+    inputs[0] = v[0]/20.0; inputs[1] = v[1]/20.0;
+}
+
+static int add_next(LineReader* in, double* raw, double* inputs) {
+    double v[2];
+    if (!next_numeric(in, "a,b", v, 2)) return 0;
+    raw[0] = in->line_no;
+    add_record(v, raw, inputs);
+    return 1;
+}
+
+static int add_parse(const char* text, size_t length, double* raw, double* inputs) {
+    double v[2];
+    (void)length;
+    if (parse_numbers(text, v, 2) != 2) return 0;
+    add_record(v, raw, inputs);
+    return 1;
+}
+
+static void add_format(char* row, size_t size, const double* raw, double score) {
+    snprintf(row, size, "%g,%g,%.2f,%g", raw[1], raw[2], score * 20.0, raw[1] + raw[2]);
+}
+
+static void doc_record(const double* v, double* raw, double* inputs) {
+    TempReading reading;
+    double temp_f = doc_fahrenheit(v[0], cli_celsius, &reading);
+    double o2 = v[2] > 100.0 ? 100.0 : v[2];  // Clamp oxygen
+    raw[1] = temp_f; raw[2] = v[1]; raw[3] = o2;
+    inputs[0] = temp_f/MED_MAX_TEMP; inputs[1] = v[1]/MED_MAX_HR; inputs[2] = o2/MED_MAX_O2;
+}
+
+static int doc_next(LineReader* in, double* raw, double* inputs) {
+    double v[3];
+    if (!next_numeric(in, "temp,heart_rate,oxygen", v, 3)) return 0;
+    raw[0] = in->line_no;
+    doc_record(v, raw, inputs);
+    return 1;
+}
+
+static int doc_parse(const char* text, size_t length, double* raw, double* inputs) {
+    double v[3];
+    (void)length;
+    if (parse_numbers(text, v, 3) != 3) return 0;
+    doc_record(v, raw, inputs);
+    return 1;
+}
+
+static void doc_format(char* row, size_t size, const double* raw, double score) {
+    double risk = score * 100.0;
+    const char* findings[3];
+    int issues_found = doc_findings(raw[1], raw[2], raw[3], findings);
+    DocVerdict verdict = doc_verdict(risk, issues_found);
+    snprintf(row, size, "%.1f,%g,%g,%.1f,\"%s\",\"%s\",\"%s\",\"%s\",\"%s\"",
+             raw[1], raw[2], raw[3], risk, verdict.status, verdict.action,
+             findings[0], findings[1], findings[2]);
+}
+
+static void fit_record(const double* v, double* raw, double* inputs) {
+    raw[1] = v[0]; raw[2] = v[1]; raw[3] = v[2];
+    inputs[0] = v[0]/FIT_MAX_WEIGHT; inputs[1] = v[1]/FIT_MAX_HEIGHT; inputs[2] = v[2]/FIT_MAX_CALS;
+}
+
+static int fit_next(LineReader* in, double* raw, double* inputs) {
+    double v[3];
+    if (!next_numeric(in, "weight,height,calories", v, 3)) return 0;
+    raw[0] = in->line_no;
+    fit_record(v, raw, inputs);
+    return 1;
+}
+
+static int fit_parse(const char* text, size_t length, double* raw, double* inputs) {
+    double v[3];
+    (void)length;
+    if (parse_numbers(text, v, 3) != 3) return 0;
+    fit_record(v, raw, inputs);
+    return 1;
+}
+
+static void fit_format(char* row, size_t size, const double* raw, double score) {
+    static const char* verdicts[] = { "BULK NEEDED.", "CUT NEEDED.", "OPTIMAL HEALTH." };
+    FitReport report = fit_report(raw[1], raw[2], raw[3]);
+    FitPlan plan = fit_plan(score);
+    double target = report.maintenance_cals + (plan == FIT_BULK ? 500 : plan == FIT_CUT ? -500 : 0);
+    snprintf(row, size, "%g,%g,%g,%.1f,\"%s\",%.1f,%.0f,\"%s\",%.3f,\"%s\",%.0f",
+             raw[1], raw[2], raw[3], report.bmi, fit_bmi_class(report.bmi), report.ideal_w,
+             report.maintenance_cals, fit_intake_class(report.calorie_diff), score, verdicts[plan], target);
+}
+
+static void spam_record(const SpamFeatures* found, double* raw, double* inputs) {
+    double features[3];
+    spam_feature_vector(found, features);
+    raw[1] = features[0]; raw[2] = features[1]; raw[3] = features[2];
+    inputs[0] = features[0]/SPAM_MAX_LINKS; inputs[1] = features[1]/SPAM_MAX_CAPS; inputs[2] = features[2]/SPAM_MAX_KEYWORDS;
+}
+
+// Emails are separated by a line holding END, as in the interactive scanner.
+// They stream through the scanner, so message size does not matter.
+static int spam_next(LineReader* in, double* raw, double* inputs) {
+    SpamStream scan;
+    SpamFeatures found;
+    char* piece;
+    size_t length;
+    int complete;
+    do {
+        long first = 0;
+        int line_start = 1;
+        spam_stream_begin(&scan, spam_matcher);
+        while ((piece = read_piece(in, &length, &complete))) {
+            if (line_start && complete && strcmp(piece, "END") == 0) break;
+            if (!first) first = in->line_no;
+            spam_feed_line(&scan, piece, length, complete);
+            line_start = complete;
+        }
+        spam_stream_end(&scan, &found);
+        raw[0] = first;
+        if (!piece && found.length == 0) return 0;
+    } while (found.length < 2);  // Empty message
+
+    spam_record(&found, raw, inputs);
+    return 1;
+}
+
+// A whole message in one string (its line breaks count as spaces)
+static int spam_parse(const char* text, size_t length, double* raw, double* inputs) {
+    SpamFeatures found;
+    spam_scan(spam_matcher, text, length, &found);
+    spam_record(&found, raw, inputs);
+    return 1;
+}
+
+static void spam_format(char* row, size_t size, const double* raw, double score) {
+    snprintf(row, size, "%.0f,%.0f,%.0f,%.1f,\"%s\"", raw[1], raw[2], raw[3], score * 100.0, spam_verdict(score));
+}
+
+static const HeadlessApp HEADLESS_APPS[] = {
+    { "diff", BRAIN_CALC_DIFF, "line,a,b,confidence,verdict", diff_next, diff_parse, diff_format, 100.0 },
+    { "add", BRAIN_CALC_ADD, "line,a,b,estimate,actual", add_next, add_parse, add_format, 20.0 },
+    { "doc", BRAIN_DOC, "line,temp_f,heart_rate,oxygen,risk,status,action,oxygen_finding,heart_finding,temp_finding",
+      doc_next, doc_parse, doc_format, 100.0 },
+    { "fit", BRAIN_FIT, "line,weight,height,calories,bmi,bmi_class,ideal_weight,maintenance,intake,score,verdict,target_kcal",
+      fit_next, fit_parse, fit_format, 1.0 },
+    { "spam", BRAIN_SPAM, "line,links,caps,keywords,spam_probability,verdict",
+      spam_next, spam_parse, spam_format, 100.0 },
+};
+#define HEADLESS_APP_COUNT (int)(sizeof(HEADLESS_APPS) / sizeof(HEADLESS_APPS[0]))
+
+// Streams every record of 'in' through the app's brain, CLI_BATCH at a time.
+// The workspace and batch buffers share one arena, sized up front.
+static long run_headless(const HeadlessApp* app, FILE* in_file, FILE* out) {
+    const NeuralNetwork* nn = acquire_brain(app->brain);
+    int width = nn ? nn->input_nodes : 0;
+    NNArena* arena = create_arena(0);
+    NNWorkspace* ws = nn && arena ? create_workspace_in(nn, arena) : NULL;
+    double* raw = ws ? arena_alloc(arena, sizeof(double) * CLI_BATCH * CLI_RAW) : NULL;
+    double* inputs = raw ? arena_alloc(arena, sizeof(double) * CLI_BATCH * width) : NULL;
+    double* scores = inputs ? arena_alloc(arena, sizeof(double) * CLI_BATCH) : NULL;
+    LineReader in;
+    long records = -1;
+
+    if (scores && reader_open(&in, in_file)) {
+        records = 0;
+        fprintf(out, "%s\n", app->header);
+        int n;
+        do {
+            n = 0;
+            while (n < CLI_BATCH && app->next(&in, raw + n * CLI_RAW, inputs + n * width)) n++;
+            if (n) predict_batch_with_workspace(nn, ws, inputs, n, scores);
+            for(int i = 0; i < n; i++) {
+                char row[CLI_ROW];
+                app->format(row, sizeof(row), raw + i * CLI_RAW, scores[i]);
+                fprintf(out, "%.0f,%s\n", raw[i * CLI_RAW], row);
+            }
+            records += n;
+        } while (n == CLI_BATCH);
+        free(in.buf);
+    }
+    free_arena(arena);
+    registry_release(brains, nn);
+    return records;
+}
+
+// --- Mailbox Scan ---
+typedef struct {
+    double features[3];  // Links, caps percentage, keywords
+    double score;
+    int readable;
+} MailVerdict;
+
+typedef struct {
+    const NeuralNetwork* nn;
+    NNWorkspace** ws;     // One per worker
+    MailVerdict* verdicts;  // One per message
+} MailScan;
+
+static void mail_visit(void* ctx, int worker, long index, const MailMessage* msg) {
+    MailScan* scan = ctx;
+    MailVerdict* v = &scan->verdicts[index];
+    v->readable = msg != NULL;
+    if (!msg) return;
+
+    SpamFeatures found;
+    spam_scan(spam_matcher, msg->data, msg->length, &found);
+    spam_feature_vector(&found, v->features);
+    double inputs[3] = { v->features[0]/SPAM_MAX_LINKS, v->features[1]/SPAM_MAX_CAPS, v->features[2]/SPAM_MAX_KEYWORDS };
+    predict_into(scan->nn, scan->ws[worker], inputs, &v->score);
+}
+
+// File names go out as quoted CSV fields
+static void write_csv_text(FILE* out, const char* text) {
+    fputc('"', out);
+    for(const char* c = text; *c; c++) {
+        if (*c == '"') fputc('"', out);
+        fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+// Scores every message of an mbox file or Maildir directory on all cores;
+// the verdicts are written in archive order. Returns the message count, -1 on failure.
+// Workspaces and verdicts come from one arena, released in one go.
+static long run_mailbox(const char* path, int threads, FILE* out) {
+    Mailbox* box = open_mailbox(path);
+    if (!box) {
+        fprintf(stderr, "Error: cannot read mailbox '%s'.\n", path);
+        return -1;
+    }
+    if (threads <= 0) threads = nn_cpu_count();
+
+    MailScan scan;
+    size_t verdict_bytes = (mailbox_count(box) + 1) * sizeof(MailVerdict);
+    NNArena* arena = create_arena(verdict_bytes + threads * sizeof(NNWorkspace*));
+    scan.nn = acquire_brain(BRAIN_SPAM);
+    scan.ws = arena ? arena_alloc(arena, threads * sizeof(NNWorkspace*)) : NULL;
+    scan.verdicts = scan.ws ? arena_alloc(arena, verdict_bytes) : NULL;
+    int ok = scan.nn && scan.verdicts;
+    if (ok) memset(scan.verdicts, 0, verdict_bytes);
+    for(int i = 0; ok && i < threads; i++) ok = (scan.ws[i] = create_workspace_in(scan.nn, arena)) != NULL;
+
+    long messages = -1;
+    if (ok) {
+        MailboxScanStats stats = mailbox_scan(box, threads, mail_visit, &scan);
+        int mbox = mailbox_format(box) == MAILBOX_MBOX;
+        fprintf(out, "message,%s,links,caps,keywords,spam_probability,verdict\n", mbox ? "offset" : "file");
+        for(long i = 0; i < mailbox_count(box); i++) {
+            const MailVerdict* v = &scan.verdicts[i];
+            fprintf(out, "%ld,", i + 1);
+            if (mbox) fprintf(out, "%zu", mailbox_offset(box, i));
+            else write_csv_text(out, mailbox_file(box, i));
+            if (v->readable) {
+                fprintf(out, ",%.0f,%.0f,%.0f,%.1f,\"%s\"\n", v->features[0], v->features[1], v->features[2],
+                        v->score * 100.0, spam_verdict(v->score));
+            } else {
+                fprintf(out, ",,,,,\"[ERROR] UNREADABLE\"\n");
+            }
+        }
+
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        double mb = stats.bytes / (1024.0 * 1024.0);
+        fprintf(stderr, ">> Scanned %ld messages (%.1f MB) in %.2fs on %d threads: %.0f msg/s, %.1f MB/s, %ld steals\n",
+                stats.messages, mb, stats.seconds, stats.threads, stats.messages / seconds, mb / seconds, stats.steals);
+        if (stats.failed) fprintf(stderr, ">> %ld messages could not be read.\n", stats.failed);
+        messages = stats.messages;
+    }
+    free_arena(arena);
+    registry_release(brains, scan.nn);
+    close_mailbox(box);
+    return messages;
+}
+
+static void headless_usage(void) {
+    fprintf(stderr, "Usage: Cortex --app diff|add|doc|fit|spam --in <records> --out <results.csv> [--celsius]\n");
+    fprintf(stderr, "       Cortex --app spam --mailbox <mbox file|Maildir> --out <results.csv> [--threads N]\n");
+    fprintf(stderr, "  diff, add: one 'a,b' pair per line (Neuro-Calc)\n");
+    fprintf(stderr, "  doc:  one 'temp,heart_rate,oxygen' per line (Fahrenheit unless --celsius)\n");
+    fprintf(stderr, "  fit:  one 'weight_kg,height_cm,calories' per line\n");
+    fprintf(stderr, "  spam: emails separated by a line holding END\n");
+    fprintf(stderr, "  '--in -' reads standard input. '--mailbox' scans a mail archive on every core.\n");
+}
+
+// Entry point for '--app': returns the process exit code
+static int headless_main(int argc, char** argv) {
+    const char* app_name = NULL;
+    const char* in_path = "-";
+    const char* out_path = NULL;
+    const char* mailbox_path = NULL;
+    int threads = 0;
+    for(int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--app") == 0 && i + 1 < argc) app_name = argv[++i];
+        else if (strcmp(argv[i], "--in") == 0 && i + 1 < argc) in_path = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "--mailbox") == 0 && i + 1 < argc) mailbox_path = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--celsius") == 0) cli_celsius = 1;
+        else { headless_usage(); return 2; }
+    }
+
+    const HeadlessApp* app = NULL;
+    for(int a = 0; a < HEADLESS_APP_COUNT; a++) {
+        if (app_name && strcmp(app_name, HEADLESS_APPS[a].name) == 0) app = &HEADLESS_APPS[a];
+    }
+    // Results need a file of their own: stdout carries the engine's status messages
+    if (!app || !out_path) { headless_usage(); return 2; }
+    if (mailbox_path && app->brain != BRAIN_SPAM) { headless_usage(); return 2; }
+
+    if (mailbox_path) {
+        FILE* out = fopen(out_path, "w");
+        if (!out) {
+            fprintf(stderr, "Error: cannot create '%s'.\n", out_path);
+            return 1;
+        }
+        setvbuf(out, NULL, _IOFBF, CLI_CHUNK);
+        long messages = run_mailbox(mailbox_path, threads, out);
+        int failed = fclose(out) != 0 || messages < 0;
+        if (!failed) fprintf(stderr, ">> %ld verdicts -> '%s'\n", messages, out_path);
+        return failed;
+    }
+
+    FILE* in = strcmp(in_path, "-") == 0 ? stdin : fopen(in_path, "rb");
+    if (!in) {
+        fprintf(stderr, "Error: cannot open '%s'.\n", in_path);
+        return 1;
+    }
+    FILE* out = fopen(out_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: cannot create '%s'.\n", out_path);
+        if (in != stdin) fclose(in);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOFBF, CLI_CHUNK);
+
+    clock_t start = clock();
+    long records = run_headless(app, in, out);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    int failed = fclose(out) != 0 || records < 0;
+    if (in != stdin) fclose(in);
+    if (failed) {
+        fprintf(stderr, "Error: processing '%s' failed.\n", in_path);
+        return 1;
+    }
+    fprintf(stderr, ">> %ld records -> '%s' (%.2fs)\n", records, out_path, seconds);
+    return 0;
+}
+
+// --- Server Mode ---
+_Static_assert(CLI_RAW <= SERVER_RAW, "headless records must fit a server request");
+
+static void serve_usage(void) {
+    fprintf(stderr, "Usage: Cortex --serve <socket> [--threads N] [--batch N] [--window-us N] [--celsius]\n");
+    fprintf(stderr, "                      [--learn [--checkpoint-s N]]\n");
+    fprintf(stderr, "  One request per line, '<app> <record>', apps as for --app:\n");
+    fprintf(stderr, "  'doc 98.6,80,97' -> 'ok <fields of the CSV row>' or 'error <reason>'.\n");
+    fprintf(stderr, "  spam takes the whole message on its line; 'stats' reports queues and latencies.\n");
+    fprintf(stderr, "  With --learn, 'learn <app> <label> <record>' trains on the label (in the app's\n");
+    fprintf(stderr, "  reported units, e.g. 'learn spam 0 <message>'); brains are saved every N seconds (60).\n");
+    fprintf(stderr, "  A brain file replaced while serving is swapped in. Stop with Ctrl+C or SIGTERM.\n");
+}
+
+#define SERVE_WATCH_MS 1000  // How often served brain files are checked for a replacement
+#define SERVE_CHECKPOINT_S 60
+
+typedef struct {
+    NNModelSlot* slots[HEADLESS_APP_COUNT];
+    NNLearner* learner;  // NULL unless --learn
+    struct stat seen[HEADLESS_APP_COUNT];  // Files as last loaded or saved, under 'lock'
+    pthread_mutex_t lock;
+    pthread_cond_t stop_changed;
+    int stop;
+} BrainWatch;
+
+static int same_file(const struct stat* a, const struct stat* b) {
+    return a->st_mtime == b->st_mtime && a->st_size == b->st_size && a->st_ino == b->st_ino;
+}
+
+// Swaps in a brain whose file was replaced while serving, e.g. retrained by
+// another Cortex. A file that fails to load (still being written by an older
+// build) is tried again on the next check. The scan holds 'lock' so that the
+// learner's own checkpoints are not taken for replacements.
+static void* brain_watch_main(void* arg) {
+    BrainWatch* watch = arg;
+    pthread_mutex_lock(&watch->lock);
+    for(int a = 0; a < HEADLESS_APP_COUNT; a++) {
+        const char* file = BRAINS[HEADLESS_APPS[a].brain].file;
+        if (stat(file, &watch->seen[a]) != 0) memset(&watch->seen[a], 0, sizeof(struct stat));
+    }
+    while (!watch->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += SERVE_WATCH_MS / 1000;
+        deadline.tv_nsec += (long)(SERVE_WATCH_MS % 1000) * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&watch->stop_changed, &watch->lock, &deadline);
+        if (watch->stop) break;
+
+        for(int a = 0; a < HEADLESS_APP_COUNT; a++) {
+            const char* file = BRAINS[HEADLESS_APPS[a].brain].file;
+            struct stat st;
+            if (stat(file, &st) == 0 && !same_file(&st, &watch->seen[a])) {
+                const NeuralNetwork* nn = registry_reload(brains, file);
+                if (nn) {
+                    watch->seen[a] = st;
+                    int swapped = watch->learner ? learner_replace(watch->learner, a, nn) : slot_swap(watch->slots[a], nn);
+                    if (swapped) fprintf(stderr, ">> Swapped in the new '%s'\n", file);
+                    else fprintf(stderr, "Error: the new '%s' takes other inputs; still serving the old one.\n", file);
+                }
+            }
+            slot_reclaim(watch->slots[a]);
+        }
+    }
+    pthread_mutex_unlock(&watch->lock);
+    return NULL;
+}
+
+// Learner checkpoints: recorded as seen so the watcher does not reload them
+static void serve_checkpoint(void* ctx, int brain, NeuralNetwork* nn) {
+    BrainWatch* watch = ctx;
+    const char* file = BRAINS[HEADLESS_APPS[brain].brain].file;
+    pthread_mutex_lock(&watch->lock);
+    save_network(nn, file);
+    if (stat(file, &watch->seen[brain]) != 0) memset(&watch->seen[brain], 0, sizeof(struct stat));
+    pthread_mutex_unlock(&watch->lock);
+}
+
+static int serve_learn(void* ctx, int model, const double* inputs, double target) {
+    return learner_feed(ctx, model, inputs, &target);
+}
+
+// Entry point for '--serve': every app's brain behind one socket
+static int serve_main(int argc, char** argv) {
+    const char* path = NULL;
+    ServerOptions options = { 0, NN_BATCH_TILE, 200, NULL, NULL };
+    int learning = 0, checkpoint_s = SERVE_CHECKPOINT_S;
+    for(int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) path = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) options.batch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--window-us") == 0 && i + 1 < argc) options.window_us = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--celsius") == 0) cli_celsius = 1;
+        else if (strcmp(argv[i], "--learn") == 0) learning = 1;
+        else if (strcmp(argv[i], "--checkpoint-s") == 0 && i + 1 < argc) checkpoint_s = atoi(argv[++i]);
+        else { serve_usage(); return 2; }
+    }
+    if (!path) { serve_usage(); return 2; }
+
+    ServerModel models[HEADLESS_APP_COUNT];
+    BrainWatch watch;
+    memset(&watch, 0, sizeof(watch));
+    const char* names[HEADLESS_APP_COUNT];
+    int ok = 1;
+    for(int a = 0; a < HEADLESS_APP_COUNT; a++) {
+        const HeadlessApp* app = &HEADLESS_APPS[a];
+        names[a] = BRAINS[app->brain].file;
+        models[a].name = app->name;
+        models[a].slot = watch.slots[a] = create_model_slot(brains, acquire_brain(app->brain));
+        models[a].parse = app->parse;
+        models[a].format = app->format;
+        models[a].label_scale = app->scale;
+        if (!models[a].slot) ok = 0;
+    }
+    // Feedback trains shadows of the served brains, published back into the slots
+    if (ok && learning) {
+        NNLearnerOptions learn = { TRAIN_BATCH, TRAIN_RATE, 0, checkpoint_s * 1000, serve_checkpoint, &watch };
+        watch.learner = create_learner(brains, names, watch.slots, HEADLESS_APP_COUNT, &learn);
+        if (!watch.learner) ok = 0;
+        options.learn = serve_learn;
+        options.learn_ctx = watch.learner;
+    }
+
+    ServerStats stats;
+    pthread_t watcher;
+    pthread_mutex_init(&watch.lock, NULL);
+    pthread_cond_init(&watch.stop_changed, NULL);
+    int watching = ok && pthread_create(&watcher, NULL, brain_watch_main, &watch) == 0;
+    if (ok) ok = run_server(path, models, HEADLESS_APP_COUNT, &options, &stats);
+    if (watching) {
+        pthread_mutex_lock(&watch.lock);
+        watch.stop = 1;
+        pthread_cond_signal(&watch.stop_changed);
+        pthread_mutex_unlock(&watch.lock);
+        pthread_join(watcher, NULL);
+    }
+    if (watch.learner) {
+        NNLearnerStats learned = learner_stats(watch.learner);
+        fprintf(stderr, ">> Feedback: %lld samples (%lld refused), %lld updates, %lld brains published\n",
+                learned.samples, learned.dropped + learned.rejected, learned.updates, learned.publishes);
+        free_learner(watch.learner);  // Final checkpoint, before the lock goes
+        watch.learner = NULL;
+    }
+    pthread_mutex_destroy(&watch.lock);
+    pthread_cond_destroy(&watch.stop_changed);
+    if (ok) {
+        fprintf(stderr, ">> %lld requests (%lld errors) from %lld connections in %lld batches (%.1f per batch), %lld pauses\n",
+                stats.requests, stats.errors, stats.connections, stats.batches,
+                stats.batches ? (double)(stats.requests - stats.errors) / stats.batches : 0.0, stats.pauses);
+        for(int st = 0; st < SERVER_STAGE_COUNT; st++) {
+            const ServerLatency* l = &stats.stages[st];
+            fprintf(stderr, "   %-8s mean %9.1f us  p50 < %9.1f us  p99 < %9.1f us\n", server_stage_name(st),
+                    l->count ? l->ns / 1e3 / l->count : 0.0, server_latency_quantile(l, 0.5) / 1e3,
+                    server_latency_quantile(l, 0.99) / 1e3);
+        }
+    }
+    for(int a = 0; a < HEADLESS_APP_COUNT; a++) free_model_slot(models[a].slot);
+    return !ok;
+}
+
 /* =============================================================
    MAIN HUB: CORTEX OS KERNEL
    ============================================================= */
-int main() {
+int main(int argc, char** argv) {
     srand(time(NULL));
+    stats_boot();
+    brains = create_registry(BRAIN_CACHE_BYTES);
+    spam_matcher = create_spam_matcher(SPAM_DEFAULT_PATTERNS, SPAM_DEFAULT_PATTERN_COUNT);
+
+    // --app: headless batch mode, no menu; --serve: socket server
+    for(int i = 1; i < argc; i++) {
+        int serve = strcmp(argv[i], "--serve") == 0;
+        if (!serve && strcmp(argv[i], "--app") != 0) continue;
+        boot_brains(0);
+        int status = serve ? serve_main(argc, argv) : headless_main(argc, argv);
+        join_brains();
+        free_registry(brains);
+        free_spam_matcher(spam_matcher);
+        stats_dump();
+        return status;
+    }
+
+    // --lazy: train missing brains on first use instead of at boot
+    int lazy = argc > 1 && strcmp(argv[1], "--lazy") == 0;
+    boot_brains(!lazy);
     int choice;
     while(1) {
         clear_screen();
@@ -668,5 +1572,9 @@ int main() {
             break;
         }
     }
+    join_brains();
+    free_registry(brains);
+    free_spam_matcher(spam_matcher);
+    stats_dump();
     return 0;
 }
\ No newline at end of file
@@ -1,4 +1,20 @@
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "nn.h"
+#include "nn_simd.h"
+#include "nn_stats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 // --- Activation Functions ---
 
@@ -10,199 +26,1296 @@ double sigmoid_derivative(double x) {
     return x * (1.0 - x);
 }
 
+// 2^f on [-0.5, 0.5], Chebyshev-node fits (relative error 1e-7 and 1e-4)
+static const double SIGMOID_POLY5[6] = {
+    1.0000000754548972, 0.6931471880262287, 0.24022107485308208,
+    0.05550357114219461, 0.009676031918326564, 0.0013390863364533504
+};
+static const double SIGMOID_POLY3[4] = {
+    0.9999245569508709, 0.6931367338836214, 0.24263947854625845, 0.055838282946220126
+};
+
+// x[i] = sigmoid(x[i]) in the network's mode
+static void sigmoid_vector(NNSigmoidMode mode, double* x, int n) {
+    if (mode == NN_SIGMOID_FAST) {
+        nn_kernels()->sigmoid_poly(x, n, SIGMOID_POLY5, 5);
+    } else if (mode == NN_SIGMOID_FASTEST) {
+        nn_kernels()->sigmoid_poly(x, n, SIGMOID_POLY3, 3);
+    } else {
+        for(int i = 0; i < n; i++) x[i] = sigmoid(x[i]);
+    }
+}
+
+// x[i] = f(x[i])
+static void activate_vector(NNActivation activation, NNSigmoidMode mode, double* x, int n) {
+    switch (activation) {
+    case NN_ACT_SIGMOID:
+        sigmoid_vector(mode, x, n);
+        break;
+    case NN_ACT_RELU:
+        for(int i = 0; i < n; i++) x[i] = x[i] > 0.0 ? x[i] : 0.0;
+        break;
+    case NN_ACT_TANH:
+        for(int i = 0; i < n; i++) x[i] = tanh(x[i]);
+        break;
+    case NN_ACT_LINEAR:
+        break;
+    }
+}
+
+// d[i] *= f'(x) where y[i] = f(x) is the layer output
+static void activation_backward(NNActivation activation, double* d, const double* y, int n) {
+    switch (activation) {
+    case NN_ACT_SIGMOID:
+        nn_kernels()->mul_deriv(d, y, n);
+        break;
+    case NN_ACT_RELU:
+        for(int i = 0; i < n; i++) if (y[i] <= 0.0) d[i] = 0.0;
+        break;
+    case NN_ACT_TANH:
+        for(int i = 0; i < n; i++) d[i] *= 1.0 - y[i] * y[i];
+        break;
+    case NN_ACT_LINEAR:
+        break;
+    }
+}
+
+// --- Memory ---
+
+void* nn_aligned_alloc(size_t bytes) {
+    // Round up so the size is a multiple of the alignment (C11 requirement)
+    bytes = (bytes + NN_ALIGNMENT - 1) / NN_ALIGNMENT * NN_ALIGNMENT;
+    if (bytes == 0) bytes = NN_ALIGNMENT;
+#ifdef _WIN32
+    void* ptr = _aligned_malloc(bytes, NN_ALIGNMENT);
+    if (!ptr) return NULL;
+#else
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, NN_ALIGNMENT, bytes) != 0) return NULL;
+#endif
+    nn_stats_alloc(bytes);
+    return ptr;
+}
+
+void nn_aligned_free(void* ptr) {
+    if (ptr) nn_stats_free();
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+// Bytes an arena hands out for a 'bytes' request
+static size_t aligned_size(size_t bytes) {
+    return (bytes + NN_ALIGNMENT - 1) / NN_ALIGNMENT * NN_ALIGNMENT;
+}
+
+// Chunks are chained in allocation order; each one's data starts one padded
+// header in. The first chunk shares one allocation with the arena itself.
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t size;  // Usable bytes
+    size_t used;
+} ArenaChunk;
+
+struct NNArena {
+    ArenaChunk* first;
+    ArenaChunk* current;  // Chunks after it are free
+    size_t chunk_bytes;
+};
+
+#define ARENA_HEADER aligned_size(sizeof(NNArena))
+#define CHUNK_HEADER aligned_size(sizeof(ArenaChunk))
+
+static void chunk_init(ArenaChunk* chunk, size_t size) {
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+}
+
+NNArena* create_arena(size_t chunk_bytes) {
+    chunk_bytes = aligned_size(chunk_bytes ? chunk_bytes : NN_ARENA_CHUNK);
+    NNArena* arena = nn_aligned_alloc(ARENA_HEADER + CHUNK_HEADER + chunk_bytes);
+    if (!arena) return NULL;
+    arena->first = (ArenaChunk*)((char*)arena + ARENA_HEADER);
+    arena->current = arena->first;
+    arena->chunk_bytes = chunk_bytes;
+    chunk_init(arena->first, chunk_bytes);
+    return arena;
+}
+
+void* arena_alloc(NNArena* arena, size_t bytes) {
+    bytes = aligned_size(bytes ? bytes : 1);
+    ArenaChunk* chunk = arena->current;
+    while (chunk->size - chunk->used < bytes) {
+        if (!chunk->next) {
+            // Out of chunks: chain a new one, big enough for oversized requests
+            size_t size = bytes > arena->chunk_bytes ? bytes : arena->chunk_bytes;
+            ArenaChunk* grown = nn_aligned_alloc(CHUNK_HEADER + size);
+            if (!grown) return NULL;
+            chunk_init(grown, size);
+            chunk->next = grown;
+        }
+        // Chunks past 'current' were released by the last reset
+        chunk = chunk->next;
+        chunk->used = 0;
+    }
+    arena->current = chunk;
+    void* ptr = (char*)chunk + CHUNK_HEADER + chunk->used;
+    chunk->used += bytes;
+    return ptr;
+}
+
+void arena_reset(NNArena* arena) {
+    arena->current = arena->first;
+    arena->first->used = 0;
+}
+
+void free_arena(NNArena* arena) {
+    if (!arena) return;
+    ArenaChunk* chunk = arena->first->next;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        nn_aligned_free(chunk);
+        chunk = next;
+    }
+    nn_aligned_free(arena);
+}
+
+size_t arena_capacity(const NNArena* arena) {
+    size_t bytes = 0;
+    for(const ArenaChunk* chunk = arena->first; chunk; chunk = chunk->next) bytes += chunk->size;
+    return bytes;
+}
+
+// Read/write private mapping of a whole file: pages stay shared with every
+// other process mapping the same file until they are written to
+static void* map_file(const char* filename, size_t* size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER length;
+    void* base = NULL;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mapping) {
+            base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mapping);  // The view keeps the mapping alive
+        }
+        *size = (size_t)length.QuadPart;
+    }
+    CloseHandle(file);
+    return base;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void* base = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) base = NULL;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return base;
+#endif
+}
+
+static void unmap_file(void* base, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, size);
+#endif
+}
+
+// CRC-32 (IEEE 802.3, reflected), table built on first use
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for(int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t size) {
+    const unsigned char* p = data;
+    pthread_once(&crc_once, crc_init);
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++) crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// --- System ---
+
+int nn_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+int nn_replace_file(const char* temp, const char* filename) {
+#ifdef _WIN32
+    // Fails while another program holds the file open without sharing it
+    if (MoveFileExA(temp, filename, MOVEFILE_REPLACE_EXISTING)) return 1;
+    fprintf(stderr, "Error: cannot replace '%s' (Windows error %lu); is it open elsewhere?\n", filename,
+            (unsigned long)GetLastError());
+#else
+    if (rename(temp, filename) == 0) return 1;
+    fprintf(stderr, "Error: cannot replace '%s': %s.\n", filename, strerror(errno));
+#endif
+    return 0;
+}
+
 // --- Lifecycle Management ---
 
-NeuralNetwork* create_network(int input, int hidden, int output) {
-    NeuralNetwork* nn = malloc(sizeof(NeuralNetwork));
-    nn->input_nodes = input;
-    nn->hidden_nodes = hidden;
-    nn->output_nodes = output;
+// Elements per cache line, used to pad rows and the bias block
+#define ROW_PAD (NN_ALIGNMENT / (int)sizeof(double))
+
+static int round_up(int n, int multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+static size_t element_size(NNPrecision precision) {
+    return precision == NN_FLOAT64 ? sizeof(double) : sizeof(float);
+}
+
+// Elements in a layer slab: padded weight rows, then the padded bias block
+static size_t layer_slab_size(const NNLayer* layer) {
+    int pad = NN_ALIGNMENT / (int)element_size(layer->precision);
+    return (size_t)layer->neurons * layer->stride + round_up(layer->neurons, pad);
+}
 
-    // Allocate Weight Matrices (Input -> Hidden)
-    nn->hidden_weights = malloc(input * sizeof(double*));
-    for(int i = 0; i < input; i++) {
-        nn->hidden_weights[i] = malloc(hidden * sizeof(double));
+// Sets a layer's shape, no storage yet.
+// 'stride' 0 picks the natural padding for the element type.
+static void layer_shape(NNLayer* layer, int inputs, int neurons, NNPrecision precision, int stride) {
+    int pad = NN_ALIGNMENT / (int)element_size(precision);
+    layer->inputs = inputs;
+    layer->neurons = neurons;
+    layer->stride = stride > 0 ? stride : round_up(inputs, pad);
+    layer->precision = precision;
+    layer->activation = NN_ACT_SIGMOID;
+    layer->weights = NULL;
+    layer->biases = NULL;
+    layer->weights_f32 = NULL;
+    layer->biases_f32 = NULL;
+}
+
+// One zeroed slab from 'arena': [neurons x stride weights][neurons biases]
+static int layer_alloc(NNLayer* layer, NNArena* arena, int inputs, int neurons, NNPrecision precision, int stride) {
+    layer_shape(layer, inputs, neurons, precision, stride);
+    size_t weight_count = (size_t)neurons * layer->stride;
+    size_t total = layer_slab_size(layer) * element_size(precision);
+    void* slab = arena_alloc(arena, total);
+    if (!slab) return 0;
+    memset(slab, 0, total);
+
+    if (precision == NN_FLOAT64) {
+        layer->weights = slab;
+        layer->biases = layer->weights + weight_count;
+    } else {
+        layer->weights_f32 = slab;
+        layer->biases_f32 = layer->weights_f32 + weight_count;
     }
+    return 1;
+}
 
-    // Allocate Weight Matrices (Hidden -> Output)
-    nn->output_weights = malloc(hidden * sizeof(double*));
-    for(int i = 0; i < hidden; i++) {
-        nn->output_weights[i] = malloc(output * sizeof(double));
+// Arena bytes for a network struct, its layer array and, with 'slabs', the weights
+static size_t network_bytes(int input, int num_layers, const int* sizes, NNPrecision precision, int slabs) {
+    size_t bytes = aligned_size(sizeof(NeuralNetwork)) + aligned_size(num_layers * sizeof(NNLayer));
+    int fan_in = input;
+    for(int l = 0; slabs && l < num_layers; l++) {
+        NNLayer layer;
+        layer_shape(&layer, fan_in, sizes[l], precision, 0);
+        bytes += aligned_size(layer_slab_size(&layer) * element_size(precision));
+        fan_in = sizes[l];
     }
+    return bytes;
+}
 
-    // Allocate Biases
-    nn->hidden_biases = malloc(hidden * sizeof(double));
-    nn->output_biases = malloc(output * sizeof(double));
+// Network struct and an empty layer array, no weight storage yet. Without an
+// arena the network gets a private one, sized for the weights too when
+// 'slabs' is set, so it lives in a single allocation.
+static NeuralNetwork* network_shell(NNArena* arena, int input, int num_layers, const int* sizes,
+                                    NNPrecision precision, int slabs) {
+    if (input <= 0 || num_layers <= 0) return NULL;
+    for(int l = 0; l < num_layers; l++) {
+        if (sizes[l] <= 0) return NULL;
+    }
+    int owns_arena = arena == NULL;
+    if (owns_arena) {
+        arena = create_arena(network_bytes(input, num_layers, sizes, precision, slabs));
+        if (!arena) return NULL;
+    }
+    NeuralNetwork* nn = arena_alloc(arena, sizeof(NeuralNetwork));
+    NNLayer* layers = nn ? arena_alloc(arena, num_layers * sizeof(NNLayer)) : NULL;
+    if (!layers) {
+        if (owns_arena) free_arena(arena);
+        return NULL;
+    }
+    memset(layers, 0, num_layers * sizeof(NNLayer));
+    nn->layers = layers;
+    nn->arena = arena;
+    nn->owns_arena = owns_arena;
+    nn->input_nodes = input;
+    nn->hidden_nodes = num_layers > 1 ? sizes[0] : 0;
+    nn->output_nodes = sizes[num_layers - 1];
+    nn->precision = precision;
+    nn->sigmoid = NN_SIGMOID_EXACT;
+    nn->num_layers = num_layers;
+    nn->mapping = NULL;
+    nn->mapping_size = 0;
+    return nn;
+}
+
+NeuralNetwork* create_layered_network_in(NNArena* arena, int input, int num_layers, const int* sizes,
+                                         const NNActivation* activations, NNPrecision precision) {
+    NeuralNetwork* nn = network_shell(arena, input, num_layers, sizes, precision, 1);
+    if (!nn) return NULL;
 
+    // Allocate Layer Slabs, each layer fed by the previous one
+    int fan_in = input;
+    for(int l = 0; l < num_layers; l++) {
+        if (!layer_alloc(&nn->layers[l], nn->arena, fan_in, sizes[l], precision, 0)) {
+            free_network(nn);
+            return NULL;
+        }
+        nn->layers[l].activation = activations ? activations[l] : NN_ACT_SIGMOID;
+        fan_in = sizes[l];
+    }
     return nn;
 }
 
-void init_network(NeuralNetwork* nn) {
-    // Randomize Hidden Weights (-1.0 to 1.0)
-    for(int i = 0; i < nn->input_nodes; i++) {
-        for(int j = 0; j < nn->hidden_nodes; j++) {
-            nn->hidden_weights[i][j] = ((double)rand() / RAND_MAX) * 2.0 - 1.0;
+NeuralNetwork* create_layered_network(int input, int num_layers, const int* sizes,
+                                      const NNActivation* activations, NNPrecision precision) {
+    return create_layered_network_in(NULL, input, num_layers, sizes, activations, precision);
+}
+
+NeuralNetwork* create_network_with_precision(int input, int hidden, int output, NNPrecision precision) {
+    int sizes[2] = { hidden, output };
+    return create_layered_network(input, 2, sizes, NULL, precision);
+}
+
+NeuralNetwork* create_network(int input, int hidden, int output) {
+    return create_network_with_precision(input, hidden, output, NN_FLOAT64);
+}
+
+// The struct lives in its own arena: read what is needed before releasing it
+void free_network(NeuralNetwork* nn) {
+    if (!nn) return;
+    if (nn->mapping) unmap_file(nn->mapping, nn->mapping_size);
+    if (nn->owns_arena) free_arena(nn->arena);
+}
+
+size_t network_memory(const NeuralNetwork* nn) {
+    if (nn->mapping) return nn->mapping_size;
+    size_t bytes = 0;
+    for(int l = 0; l < nn->num_layers; l++) {
+        bytes += layer_slab_size(&nn->layers[l]) * element_size(nn->layers[l].precision);
+    }
+    return bytes;
+}
+
+static void copy_layer(NNLayer* dst, const NNLayer* src) {
+    for(int n = 0; n < src->neurons; n++) {
+        for(int i = 0; i < src->inputs; i++) set_weight(dst, i, n, get_weight(src, i, n));
+        set_bias(dst, n, get_bias(src, n));
+    }
+}
+
+NeuralNetwork* convert_network(const NeuralNetwork* nn, NNPrecision precision) {
+    int* sizes = malloc(nn->num_layers * sizeof(int));
+    NNActivation* activations = malloc(nn->num_layers * sizeof(NNActivation));
+    NeuralNetwork* copy = NULL;
+    if (sizes && activations) {
+        for(int l = 0; l < nn->num_layers; l++) {
+            sizes[l] = nn->layers[l].neurons;
+            activations[l] = nn->layers[l].activation;
         }
+        copy = create_layered_network(nn->input_nodes, nn->num_layers, sizes, activations, precision);
     }
-    // Randomize Output Weights (-1.0 to 1.0)
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        for(int j = 0; j < nn->output_nodes; j++) {
-            nn->output_weights[i][j] = ((double)rand() / RAND_MAX) * 2.0 - 1.0;
+    free(sizes);
+    free(activations);
+    if (!copy) return NULL;
+
+    copy->sigmoid = nn->sigmoid;
+    for(int l = 0; l < nn->num_layers; l++) copy_layer(&copy->layers[l], &nn->layers[l]);
+    return copy;
+}
+
+void init_network(NeuralNetwork* nn) {
+    // Randomize Weights (-1.0 to 1.0), layer by layer in [from][to] order
+    for(int l = 0; l < nn->num_layers; l++) {
+        NNLayer* layer = &nn->layers[l];
+        for(int i = 0; i < layer->inputs; i++) {
+            for(int j = 0; j < layer->neurons; j++) {
+                set_weight(layer, i, j, ((double)rand() / RAND_MAX) * 2.0 - 1.0);
+            }
         }
     }
     // Initialize Biases to 0
-    for(int i = 0; i < nn->hidden_nodes; i++) nn->hidden_biases[i] = 0.0;
-    for(int i = 0; i < nn->output_nodes; i++) nn->output_biases[i] = 0.0;
+    for(int l = 0; l < nn->num_layers; l++) {
+        for(int i = 0; i < nn->layers[l].neurons; i++) set_bias(&nn->layers[l], i, 0.0);
+    }
 }
 
 // --- Neural Network Operations ---
 
-double* predict(NeuralNetwork* nn, double* inputs) {
-    // 1. Hidden Layer Activation
-    double* hidden_layer = malloc(nn->hidden_nodes * sizeof(double));
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        double sum = 0.0;
-        for(int j = 0; j < nn->input_nodes; j++) {
-            sum += inputs[j] * nn->hidden_weights[j][i];
+// Below one vector of fan-in the SIMD kernels would only run their scalar
+// tail, so narrow layers keep the plain inlined loops
+#define SIMD_MIN_FANIN 4
+
+static double dot_inline(const double* a, const double* b, int n) {
+    double sum = 0.0;
+    for(int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+// Float layers: the input vector is converted once into 'x', then every row
+// is a float dot product, accumulated in float (NN_FLOAT32) or double (NN_MIXED)
+static double layer_dot_f32(const NNLayer* layer, const NNKernels* k, const float* x, int n) {
+    const float* row = layer->weights_f32 + (size_t)n * layer->stride;
+    if (layer->precision == NN_MIXED) return k->dot_f32_acc64(x, row, layer->inputs) + layer->biases_f32[n];
+    return (double)(k->dot_f32(x, row, layer->inputs) + layer->biases_f32[n]);
+}
+
+// Dense layer forward pass over a tile of samples (row-major, one sample per
+// row): out[s][n] = f(W[n] . in[s] + b[n]). Sums are computed in 4-neuron x
+// 4-sample register blocks; the kernels share one reduction order, so a
+// sample's result does not depend on the tile it was computed in.
+// 'scratch' holds the float copy of the inputs for float layers.
+static void layer_forward(const NNLayer* layer, NNSigmoidMode mode, const double* in, int ld_in,
+                          int count, float* scratch, double* out, int ld_out) {
+    const NNKernels* k = nn_kernels();
+
+    if (layer->precision != NN_FLOAT64) {
+        // Convert the tile once, then reuse each float row across the samples
+        for(int s = 0; s < count; s++) {
+            for(int i = 0; i < layer->inputs; i++) {
+                scratch[(size_t)s * layer->inputs + i] = (float)in[(size_t)s * ld_in + i];
+            }
+        }
+        for(int n = 0; n < layer->neurons; n++) {
+            for(int s = 0; s < count; s++) {
+                out[(size_t)s * ld_out + n] = layer_dot_f32(layer, k, scratch + (size_t)s * layer->inputs, n);
+            }
+        }
+    } else {
+        for(int r0 = 0; r0 < layer->neurons; r0 += 4) {
+            int rows = layer->neurons - r0 < 4 ? layer->neurons - r0 : 4;
+            const double* w = layer->weights + (size_t)r0 * layer->stride;
+
+            for(int s0 = 0; s0 < count; s0 += 4) {
+                int samples = count - s0 < 4 ? count - s0 : 4;
+                const double* x = in + (size_t)s0 * ld_in;
+                double acc[4][4];
+
+                if (layer->inputs < SIMD_MIN_FANIN) {
+                    for(int s = 0; s < samples; s++) {
+                        for(int r = 0; r < rows; r++) {
+                            acc[s][r] = dot_inline(x + (size_t)s * ld_in, w + (size_t)r * layer->stride, layer->inputs);
+                        }
+                    }
+                } else if (rows == 4 && samples == 4) {
+                    k->gemm4x4(x, ld_in, w, layer->stride, layer->inputs, acc);
+                } else if (rows == 4) {
+                    // Fewer samples (e.g. single-sample calls): four rows at a time
+                    for(int s = 0; s < samples; s++) {
+                        k->dot4(x + (size_t)s * ld_in, w, layer->stride, layer->inputs, acc[s]);
+                    }
+                } else {
+                    // Edge tile
+                    for(int s = 0; s < samples; s++) {
+                        for(int r = 0; r < rows; r++) {
+                            acc[s][r] = k->dot(x + (size_t)s * ld_in, w + (size_t)r * layer->stride, layer->inputs);
+                        }
+                    }
+                }
+
+                for(int s = 0; s < samples; s++) {
+                    double* y = out + (size_t)(s0 + s) * ld_out + r0;
+                    for(int r = 0; r < rows; r++) {
+                        y[r] = acc[s][r] + layer->biases[r0 + r];
+                    }
+                }
+            }
         }
-        sum += nn->hidden_biases[i];
-        hidden_layer[i] = sigmoid(sum);
     }
 
-    // 2. Output Layer Activation
-    double* outputs = malloc(nn->output_nodes * sizeof(double));
-    for(int i = 0; i < nn->output_nodes; i++) {
-        double sum = 0.0;
-        for(int j = 0; j < nn->hidden_nodes; j++) {
-            sum += hidden_layer[j] * nn->output_weights[j][i];
+    for(int s = 0; s < count; s++) activate_vector(layer->activation, mode, out + (size_t)s * ld_out, layer->neurons);
+}
+
+// --- Fixed-Topology Kernels ---
+
+// Every app brain is input -> 8 sigmoid -> 1 sigmoid in double precision. At
+// that size the generic layer loops and kernel calls cost more than the
+// arithmetic, so these shapes get passes of their own: the sizes are
+// constants, the loops unroll completely, the weights are copied to the stack
+// once per call and a sample never leaves its stack buffers. Sums follow the
+// scalar kernels (multiply, then add, in index order), so the results match
+// CORTEX_SIMD=scalar bit for bit. Build with -DNN_NO_FIXED_KERNELS to always
+// take the generic path.
+#define FIXED_MAX 8  // Widest layer a specialization may have
+
+#if defined(__GNUC__)
+#define FIXED_INLINE static inline __attribute__((always_inline))
+#else
+#define FIXED_INLINE static inline
+#endif
+
+typedef struct {
+    int inputs, hidden, outputs;
+    // forward_tile / backward_tile for this shape
+    void (*forward)(const NeuralNetwork* nn, const double* inputs, int count, double* hidden, double* outputs);
+    void (*backward)(const NeuralNetwork* nn, NNWorkspace* ws, const double* targets, int count);
+    // The single-sample weight update of train_with_workspace
+    void (*update)(NeuralNetwork* nn, const NNWorkspace* ws, const double* inputs, double learning_rate);
+} FixedKernels;
+
+// I inputs -> H hidden -> O outputs, all compile-time constants once inlined
+FIXED_INLINE void fixed_forward(int I, int H, int O, const NeuralNetwork* nn, const double* inputs, int count,
+                                double* hidden, double* outputs) {
+    const NNLayer* l1 = &nn->layers[0];
+    const NNLayer* l2 = &nn->layers[1];
+    double w1[FIXED_MAX][FIXED_MAX], b1[FIXED_MAX], w2[FIXED_MAX][FIXED_MAX], b2[FIXED_MAX];
+    for(int n = 0; n < H; n++) {
+        for(int i = 0; i < I; i++) w1[n][i] = l1->weights[n * l1->stride + i];
+        b1[n] = l1->biases[n];
+    }
+    for(int o = 0; o < O; o++) {
+        for(int n = 0; n < H; n++) w2[o][n] = l2->weights[o * l2->stride + n];
+        b2[o] = l2->biases[o];
+    }
+
+    for(int s = 0; s < count; s++) {
+        const double* x = inputs + (size_t)s * I;
+        double* h = hidden + (size_t)s * H;
+        double* y = outputs + (size_t)s * O;
+        for(int n = 0; n < H; n++) {
+            double sum = 0.0;
+            for(int i = 0; i < I; i++) sum += x[i] * w1[n][i];
+            h[n] = sum + b1[n];
         }
-        sum += nn->output_biases[i];
-        outputs[i] = sigmoid(sum);
+        sigmoid_vector(nn->sigmoid, h, H);
+        for(int o = 0; o < O; o++) {
+            double sum = 0.0;
+            for(int n = 0; n < H; n++) sum += h[n] * w2[o][n];
+            y[o] = sum + b2[o];
+        }
+        sigmoid_vector(nn->sigmoid, y, O);
     }
-    
-    free(hidden_layer);
-    return outputs;
 }
 
-void train(NeuralNetwork* nn, double* inputs, double* targets, double learning_rate) {
-    /* --- Forward Pass --- */
-    
-    // Compute Hidden Layer
-    double* hidden_layer = malloc(nn->hidden_nodes * sizeof(double));
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        double sum = 0.0;
-        for(int j = 0; j < nn->input_nodes; j++) {
-            sum += inputs[j] * nn->hidden_weights[j][i];
+FIXED_INLINE void fixed_backward(int H, int O, const NeuralNetwork* nn, NNWorkspace* ws, const double* targets, int count) {
+    const NNLayer* l2 = &nn->layers[1];
+    double w2[FIXED_MAX][FIXED_MAX];
+    for(int o = 0; o < O; o++) {
+        for(int n = 0; n < H; n++) w2[o][n] = l2->weights[o * l2->stride + n];
+    }
+
+    for(int s = 0; s < count; s++) {
+        const double* h = ws->acts[0] + (size_t)s * H;
+        const double* y = ws->acts[1] + (size_t)s * O;
+        double* dh = ws->deltas[0] + (size_t)s * H;
+        double* dy = ws->deltas[1] + (size_t)s * O;
+        for(int o = 0; o < O; o++) dy[o] = (targets[(size_t)s * O + o] - y[o]) * (y[o] * (1.0 - y[o]));
+        for(int n = 0; n < H; n++) {
+            double sum = 0.0;
+            for(int o = 0; o < O; o++) sum += dy[o] * w2[o][n];
+            dh[n] = sum * (h[n] * (1.0 - h[n]));
         }
-        sum += nn->hidden_biases[i];
-        hidden_layer[i] = sigmoid(sum);
     }
+}
 
-    // Compute Output Layer
-    double* outputs = malloc(nn->output_nodes * sizeof(double));
-    for(int i = 0; i < nn->output_nodes; i++) {
-        double sum = 0.0;
-        for(int j = 0; j < nn->hidden_nodes; j++) {
-            sum += hidden_layer[j] * nn->output_weights[j][i];
+FIXED_INLINE void fixed_update(int I, int H, int O, NeuralNetwork* nn, const NNWorkspace* ws, const double* inputs,
+                               double learning_rate) {
+    NNLayer* l1 = &nn->layers[0];
+    NNLayer* l2 = &nn->layers[1];
+    for(int o = 0; o < O; o++) {
+        double step = learning_rate * ws->deltas[1][o];
+        double* row = l2->weights + o * l2->stride;
+        for(int n = 0; n < H; n++) row[n] += step * ws->acts[0][n];
+        l2->biases[o] += step;
+    }
+    for(int n = 0; n < H; n++) {
+        double step = learning_rate * ws->deltas[0][n];
+        double* row = l1->weights + n * l1->stride;
+        for(int i = 0; i < I; i++) row[i] += step * inputs[i];
+        l1->biases[n] += step;
+    }
+}
+
+// One set of passes per shape
+#define FIXED_SHAPE(I, H, O)                                                                                   \
+    static void forward_##I##_##H##_##O(const NeuralNetwork* nn, const double* inputs, int count,              \
+                                        double* hidden, double* outputs) {                                     \
+        fixed_forward(I, H, O, nn, inputs, count, hidden, outputs);                                            \
+    }                                                                                                          \
+    static void backward_##I##_##H##_##O(const NeuralNetwork* nn, NNWorkspace* ws, const double* targets,      \
+                                         int count) {                                                          \
+        fixed_backward(H, O, nn, ws, targets, count);                                                          \
+    }                                                                                                          \
+    static void update_##I##_##H##_##O(NeuralNetwork* nn, const NNWorkspace* ws, const double* inputs,         \
+                                       double learning_rate) {                                                 \
+        fixed_update(I, H, O, nn, ws, inputs, learning_rate);                                                  \
+    }
+
+FIXED_SHAPE(3, 8, 1)  // Doc-AI, Fit-Bot, Spam-Guard
+FIXED_SHAPE(2, 8, 1)  // Neuro-Calc
+
+static const FixedKernels FIXED_KERNELS[] = {
+    { 3, 8, 1, forward_3_8_1, backward_3_8_1, update_3_8_1 },
+    { 2, 8, 1, forward_2_8_1, backward_2_8_1, update_2_8_1 },
+};
+
+// Specialized passes for the network's shape, or NULL for the generic path
+static const FixedKernels* fixed_kernels(const NeuralNetwork* nn) {
+#ifdef NN_NO_FIXED_KERNELS
+    (void)nn;
+    return NULL;
+#else
+    if (nn->num_layers != 2 || nn->precision != NN_FLOAT64) return NULL;
+    if (nn->layers[0].activation != NN_ACT_SIGMOID || nn->layers[1].activation != NN_ACT_SIGMOID) return NULL;
+    for(size_t k = 0; k < sizeof(FIXED_KERNELS) / sizeof(FIXED_KERNELS[0]); k++) {
+        const FixedKernels* f = &FIXED_KERNELS[k];
+        if (nn->input_nodes == f->inputs && nn->layers[0].neurons == f->hidden && nn->layers[1].neurons == f->outputs) return f;
+    }
+    return NULL;
+#endif
+}
+
+// Forward pass of the whole stack over up to NN_BATCH_TILE samples. Layer
+// outputs go to ws->acts; with 'outputs' set the last layer writes there instead.
+static void forward_tile(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, int count, double* outputs) {
+    const FixedKernels* fixed = fixed_kernels(nn);
+    if (fixed) {
+        fixed->forward(nn, inputs, count, ws->acts[0], outputs ? outputs : ws->acts[1]);
+        return;
+    }
+
+    const double* in = inputs;
+    int ld_in = nn->input_nodes;
+    for(int l = 0; l < nn->num_layers; l++) {
+        const NNLayer* layer = &nn->layers[l];
+        double* out = outputs && l == nn->num_layers - 1 ? outputs : ws->acts[l];
+        layer_forward(layer, nn->sigmoid, in, ld_in, count, ws->scratch_f32, out, layer->neurons);
+        in = out;
+        ld_in = layer->neurons;
+    }
+}
+
+// deltas += delta * W[n], the backprop step through one weight row
+static void backprop_row(const NNLayer* layer, const NNKernels* k, int n, double delta, double* deltas) {
+    if (layer->precision == NN_FLOAT64) {
+        k->axpy(deltas, delta, layer->weights + (size_t)n * layer->stride, layer->inputs);
+        return;
+    }
+    const float* row = layer->weights_f32 + (size_t)n * layer->stride;
+    for(int i = 0; i < layer->inputs; i++) deltas[i] += delta * row[i];
+}
+
+// Backward pass of the whole stack for the tile left in ws->acts by
+// forward_tile: fills ws->deltas for every layer, using the current weights
+static void backward_tile(const NeuralNetwork* nn, NNWorkspace* ws, const double* targets, int count) {
+    const FixedKernels* fixed = fixed_kernels(nn);
+    if (fixed) {
+        fixed->backward(nn, ws, targets, count);
+        return;
+    }
+
+    const NNKernels* k = nn_kernels();
+    int last = nn->num_layers - 1;
+
+    // 1. Output Gradients (Error * Derivative)
+    int values = count * nn->output_nodes;
+    for(int i = 0; i < values; i++) ws->deltas[last][i] = targets[i] - ws->acts[last][i];
+    activation_backward(nn->layers[last].activation, ws->deltas[last], ws->acts[last], values);
+
+    // 2. Hidden Gradients, top down: (deltas x weights) * derivative
+    for(int l = last; l > 0; l--) {
+        const NNLayer* layer = &nn->layers[l];
+        for(int s = 0; s < count; s++) {
+            const double* d = ws->deltas[l] + (size_t)s * layer->neurons;
+            double* prev = ws->deltas[l - 1] + (size_t)s * layer->inputs;
+            for(int i = 0; i < layer->inputs; i++) prev[i] = 0.0;
+            for(int j = 0; j < layer->neurons; j++) backprop_row(layer, k, j, d[j], prev);
+        }
+        activation_backward(nn->layers[l - 1].activation, ws->deltas[l - 1], ws->acts[l - 1], count * layer->inputs);
+    }
+}
+
+// FLOPs (2 per multiply-add) of one sample through layers[from..], for the stats
+static long long dense_flops(const NeuralNetwork* nn, int from) {
+    long long macs = 0;
+    for(int l = from; l < nn->num_layers; l++) macs += (long long)nn->layers[l].inputs * nn->layers[l].neurons;
+    return 2 * macs;
+}
+
+// --- Workspace ---
+
+// Arena bytes of a workspace for 'nn' with 'rows'-sample tiles: struct,
+// pointer arrays, tiles, float scratch and (optionally) gradient slabs,
+// in create_workspace_sized order
+static size_t workspace_bytes(const NeuralNetwork* nn, int rows, int gradients) {
+    int layers = nn->num_layers;
+    size_t bytes = aligned_size(sizeof(NNWorkspace)) + aligned_size(2 * (size_t)layers * sizeof(double*)) +
+                   aligned_size(layers * sizeof(NNLayer));
+    int widest = nn->input_nodes;
+    for(int l = 0; l < layers; l++) {
+        const NNLayer* layer = &nn->layers[l];
+        bytes += aligned_size(2 * (size_t)rows * round_up(layer->neurons, ROW_PAD) * sizeof(double));
+        if (gradients) {
+            NNLayer grads;
+            layer_shape(&grads, layer->inputs, layer->neurons, NN_FLOAT64, layer->stride);
+            bytes += aligned_size(layer_slab_size(&grads) * sizeof(double));
         }
-        sum += nn->output_biases[i];
-        outputs[i] = sigmoid(sum);
+        if (layer->inputs > widest) widest = layer->inputs;
+    }
+    if (nn->precision != NN_FLOAT64) bytes += aligned_size((size_t)rows * widest * sizeof(float));
+    return bytes;
+}
+
+// Workspace whose tiles hold 'rows' samples. Without 'gradients' the grads
+// layers stay zero-sized: enough for predict_into and train_with_workspace,
+// not for the mini-batch calls (workspace_fits then says no).
+static NNWorkspace* create_workspace_sized(const NeuralNetwork* nn, NNArena* arena, int rows, int gradients) {
+    int layers = nn->num_layers;
+    int owns_arena = arena == NULL;
+    if (owns_arena) {
+        arena = create_arena(workspace_bytes(nn, rows, gradients));
+        if (!arena) return NULL;
+    }
+    NNWorkspace* ws = arena_alloc(arena, sizeof(NNWorkspace));
+    if (!ws) {
+        if (owns_arena) free_arena(arena);
+        return NULL;
+    }
+    memset(ws, 0, sizeof(NNWorkspace));
+    ws->num_layers = layers;
+    ws->arena = arena;
+    ws->owns_arena = owns_arena;
+    ws->acts = arena_alloc(arena, 2 * (size_t)layers * sizeof(double*));
+    ws->grads = arena_alloc(arena, layers * sizeof(NNLayer));
+    if (!ws->acts || !ws->grads) {
+        free_workspace(ws);
+        return NULL;
+    }
+    ws->deltas = ws->acts + layers;
+    memset(ws->grads, 0, layers * sizeof(NNLayer));
+
+    // Per layer, a tile of outputs then a tile of deltas
+    int widest = nn->input_nodes;
+    for(int l = 0; l < layers; l++) {
+        size_t tile = (size_t)rows * round_up(nn->layers[l].neurons, ROW_PAD);
+        ws->acts[l] = arena_alloc(arena, 2 * tile * sizeof(double));
+        if (!ws->acts[l]) {
+            free_workspace(ws);
+            return NULL;
+        }
+        ws->deltas[l] = ws->acts[l] + tile;
+        if (nn->layers[l].inputs > widest) widest = nn->layers[l].inputs;
+    }
+
+    // Float networks convert each layer's input tile before the dot products
+    if (nn->precision != NN_FLOAT64) {
+        ws->scratch_f32 = arena_alloc(arena, (size_t)rows * widest * sizeof(float));
+        if (!ws->scratch_f32) {
+            free_workspace(ws);
+            return NULL;
+        }
+    }
+
+    // Gradient accumulators share the layer shapes (and strides), in double
+    for(int l = 0; gradients && l < layers; l++) {
+        const NNLayer* layer = &nn->layers[l];
+        if (!layer_alloc(&ws->grads[l], arena, layer->inputs, layer->neurons, NN_FLOAT64, layer->stride)) {
+            free_workspace(ws);
+            return NULL;
+        }
+    }
+    return ws;
+}
+
+NNWorkspace* create_workspace_in(const NeuralNetwork* nn, NNArena* arena) {
+    return create_workspace_sized(nn, arena, NN_BATCH_TILE, 1);
+}
+
+NNWorkspace* create_workspace(const NeuralNetwork* nn) {
+    return create_workspace_in(nn, NULL);
+}
+
+void free_workspace(NNWorkspace* ws) {
+    if (ws && ws->owns_arena) free_arena(ws->arena);
+}
+
+int workspace_fits(const NNWorkspace* ws, const NeuralNetwork* nn) {
+    if (ws->num_layers != nn->num_layers || (nn->precision != NN_FLOAT64 && !ws->scratch_f32)) return 0;
+    for(int l = 0; l < nn->num_layers; l++) {
+        const NNLayer* grads = &ws->grads[l];
+        const NNLayer* layer = &nn->layers[l];
+        if (grads->inputs != layer->inputs || grads->neurons != layer->neurons || grads->stride != layer->stride) return 0;
     }
+    return 1;
+}
 
-    /* --- Backpropagation --- */
-    
-    // 1. Calculate Output Gradients (Error * Derivative)
-    double* output_deltas = malloc(nn->output_nodes * sizeof(double));
-    for(int i = 0; i < nn->output_nodes; i++) {
-        double error = targets[i] - outputs[i];
-        output_deltas[i] = error * sigmoid_derivative(outputs[i]);
+double* predict_in(NNArena* arena, const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs) {
+    double* outputs = arena_alloc(arena, nn->output_nodes * sizeof(double));
+    if (outputs) predict_into(nn, ws, inputs, outputs);
+    return outputs;
+}
+
+void predict_into(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, double* outputs) {
+    uint64_t start = nn_stats_begin();
+    forward_tile(nn, ws, inputs, 1, outputs);
+    if (start) nn_stats_op(NN_OP_PREDICT, start, nn_stats_phase(NN_PHASE_FORWARD, start), 1, dense_flops(nn, 0));
+}
+
+void predict_batch_with_workspace(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, int n, double* outputs) {
+    uint64_t start = nn_stats_begin();
+    // Walk the batch one tile at a time so the hidden activations stay in cache
+    for(int s0 = 0; s0 < n; s0 += NN_BATCH_TILE) {
+        int count = n - s0 < NN_BATCH_TILE ? n - s0 : NN_BATCH_TILE;
+        forward_tile(nn, ws, inputs + (size_t)s0 * nn->input_nodes, count, outputs + (size_t)s0 * nn->output_nodes);
     }
+    if (start) nn_stats_op(NN_OP_PREDICT_BATCH, start, nn_stats_phase(NN_PHASE_FORWARD, start), n, n * dense_flops(nn, 0));
+}
+
+void predict_batch(const NeuralNetwork* nn, const double* inputs, int n, double* outputs) {
+    NNWorkspace* ws = create_workspace(nn);
+    if (!ws) return;
+    predict_batch_with_workspace(nn, ws, inputs, n, outputs);
+    free_workspace(ws);
+}
 
-    // 2. Calculate Hidden Gradients
-    double* hidden_deltas = malloc(nn->hidden_nodes * sizeof(double));
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        double error = 0.0;
-        for(int j = 0; j < nn->output_nodes; j++) {
-            error += output_deltas[j] * nn->output_weights[i][j];
+// W[n] += step * x, b[n] += step. Float weights are updated in double and rounded once.
+static void update_row(NNLayer* layer, const NNKernels* k, int n, double step, const double* x) {
+    if (layer->precision == NN_FLOAT64) {
+        k->axpy(layer->weights + (size_t)n * layer->stride, step, x, layer->inputs);
+        layer->biases[n] += step;
+        return;
+    }
+    float* row = layer->weights_f32 + (size_t)n * layer->stride;
+    for(int i = 0; i < layer->inputs; i++) row[i] = (float)(row[i] + step * x[i]);
+    layer->biases_f32[n] = (float)(layer->biases_f32[n] + step);
+}
+
+void train_with_workspace(NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, const double* targets, double learning_rate) {
+    const NNKernels* k = nn_kernels();
+    uint64_t start = nn_stats_begin();
+
+    /* --- Forward Pass & Backpropagation --- */
+    forward_tile(nn, ws, inputs, 1, NULL);
+    uint64_t t = nn_stats_phase(NN_PHASE_FORWARD, start);
+    backward_tile(nn, ws, targets, 1);
+    t = nn_stats_phase(NN_PHASE_BACKWARD, t);
+
+    /* --- Update Weights & Biases (output layer first, one row per neuron) --- */
+    const FixedKernels* fixed = fixed_kernels(nn);
+    if (fixed) {
+        fixed->update(nn, ws, inputs, learning_rate);
+    } else {
+        for(int l = nn->num_layers - 1; l >= 0; l--) {
+            const double* in = l > 0 ? ws->acts[l - 1] : inputs;
+            for(int i = 0; i < nn->layers[l].neurons; i++) {
+                update_row(&nn->layers[l], k, i, learning_rate * ws->deltas[l][i], in);
+            }
         }
-        hidden_deltas[i] = error * sigmoid_derivative(hidden_layer[i]);
     }
+    if (start) {
+        t = nn_stats_phase(NN_PHASE_UPDATE, t);
+        nn_stats_op(NN_OP_TRAIN, start, t, 1, 2 * dense_flops(nn, 0) + dense_flops(nn, 1));
+    }
+}
+
+// --- Mini-Batch Training ---
 
-    // 3. Update Output Weights & Biases
-    for(int i = 0; i < nn->output_nodes; i++) {
-        for(int j = 0; j < nn->hidden_nodes; j++) {
-            nn->output_weights[j][i] += learning_rate * output_deltas[i] * hidden_layer[j];
+// grad[n] += sum over the tile of deltas[s][n] * acts[s] (and the bias term)
+static void accumulate_outer(NNLayer* grad, const double* deltas, int ld_deltas,
+                             const double* acts, int ld_acts, int count) {
+    const NNKernels* k = nn_kernels();
+    for(int n = 0; n < grad->neurons; n++) {
+        double* g = grad->weights + (size_t)n * grad->stride;
+        double bias = 0.0;
+        for(int s = 0; s < count; s++) {
+            double d = deltas[(size_t)s * ld_deltas + n];
+            k->axpy(g, d, acts + (size_t)s * ld_acts, grad->inputs);
+            bias += d;
         }
-        nn->output_biases[i] += learning_rate * output_deltas[i];
+        grad->biases[n] += bias;
     }
+}
 
-    // 4. Update Hidden Weights & Biases
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        for(int j = 0; j < nn->input_nodes; j++) {
-            nn->hidden_weights[j][i] += learning_rate * hidden_deltas[i] * inputs[j];
+void zero_gradients(NNWorkspace* ws) {
+    for(int l = 0; l < ws->num_layers; l++) {
+        size_t size = layer_slab_size(&ws->grads[l]);
+        for(size_t k = 0; k < size; k++) ws->grads[l].weights[k] = 0.0;
+    }
+}
+
+void accumulate_gradients(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, const double* targets, int n) {
+    uint64_t start = nn_stats_begin(), t = start;
+    for(int s0 = 0; s0 < n; s0 += NN_BATCH_TILE) {
+        int count = n - s0 < NN_BATCH_TILE ? n - s0 : NN_BATCH_TILE;
+        const double* x = inputs + (size_t)s0 * nn->input_nodes;
+
+        forward_tile(nn, ws, x, count, NULL);
+        t = nn_stats_phase(NN_PHASE_FORWARD, t);
+        backward_tile(nn, ws, targets + (size_t)s0 * nn->output_nodes, count);
+
+        // Accumulate Weight & Bias Gradients over the tile
+        for(int l = nn->num_layers - 1; l >= 0; l--) {
+            const NNLayer* layer = &nn->layers[l];
+            const double* in = l > 0 ? ws->acts[l - 1] : x;
+            accumulate_outer(&ws->grads[l], ws->deltas[l], layer->neurons, in, layer->inputs, count);
         }
-        nn->hidden_biases[i] += learning_rate * hidden_deltas[i];
+        t = nn_stats_phase(NN_PHASE_BACKWARD, t);
     }
+    if (start) nn_stats_op(NN_OP_GRADIENTS, start, t, n, n * (2 * dense_flops(nn, 0) + dense_flops(nn, 1)));
+}
 
-    // Cleanup
-    free(hidden_layer);
-    free(outputs);
-    free(output_deltas);
-    free(hidden_deltas);
+void add_gradients(NNWorkspace* dst, const NNWorkspace* src) {
+    for(int l = 0; l < dst->num_layers; l++) {
+        nn_kernels()->axpy(dst->grads[l].weights, 1.0, src->grads[l].weights, layer_slab_size(&dst->grads[l]));
+    }
+}
+
+static void apply_layer_gradients(NNLayer* layer, const NNLayer* grad, double scale) {
+    if (layer->precision == NN_FLOAT64) {
+        // Whole slab at once: padding stays zero in both weights and gradients
+        nn_kernels()->axpy(layer->weights, scale, grad->weights, layer_slab_size(layer));
+        return;
+    }
+    // Float slabs pad differently, so walk the rows (the strides match)
+    for(int n = 0; n < layer->neurons; n++) {
+        float* w = layer->weights_f32 + (size_t)n * layer->stride;
+        const double* g = grad->weights + (size_t)n * grad->stride;
+        for(int i = 0; i < layer->inputs; i++) w[i] = (float)(w[i] + scale * g[i]);
+        layer->biases_f32[n] = (float)(layer->biases_f32[n] + scale * grad->biases[n]);
+    }
+}
+
+void apply_gradients(NeuralNetwork* nn, const NNWorkspace* ws, double scale) {
+    uint64_t start = nn_stats_begin();
+    for(int l = 0; l < nn->num_layers; l++) apply_layer_gradients(&nn->layers[l], &ws->grads[l], scale);
+    nn_stats_phase(NN_PHASE_UPDATE, start);
+}
+
+void train_batch(NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, const double* targets, int n, double learning_rate) {
+    if (n <= 0) return;
+    uint64_t start = nn_stats_begin();
+    zero_gradients(ws);
+    accumulate_gradients(nn, ws, inputs, targets, n);
+    apply_gradients(nn, ws, learning_rate / n);
+    if (start) nn_stats_op(NN_OP_TRAIN_BATCH, start, 0, n, n * (2 * dense_flops(nn, 0) + dense_flops(nn, 1)) + dense_flops(nn, 0));
+}
+
+// One-shot wrappers: they pay for a temporary one-sample workspace (no
+// gradient slabs) on every call
+double* predict(NeuralNetwork* nn, double* inputs) {
+    double* outputs = malloc(nn->output_nodes * sizeof(double));
+    NNWorkspace* ws = outputs ? create_workspace_sized(nn, NULL, 1, 0) : NULL;
+    if (!ws) {
+        free(outputs);
+        return NULL;
+    }
+    predict_into(nn, ws, inputs, outputs);
+    free_workspace(ws);
+    return outputs;
+}
+
+void train(NeuralNetwork* nn, double* inputs, double* targets, double learning_rate) {
+    NNWorkspace* ws = create_workspace_sized(nn, NULL, 1, 0);
+    if (!ws) return;
+    train_with_workspace(nn, ws, inputs, targets, learning_rate);
+    free_workspace(ws);
 }
 
 // --- Persistence (I/O) ---
 
+// Current format (version 3) is the in-memory layout, so a file can be
+// mapped and used in place:
+//   NNFileHeader, num_layers x NNFileLayer, zero padding to header_size
+//   (a page multiple), then each layer's slab exactly as layer_alloc lays it
+//   out (padded rows, then the padded biases) at 64-byte aligned offsets.
+// Files from before the header (no magic) are parsed and copied instead:
+// the int topology, double weights in [from][to] order, then the biases.
+#define NN_FILE_MAGIC "CRTX"
+#define NN_FILE_VERSION 3
+#define NN_FILE_ENDIAN 0x01020304u  // Reads back byte-swapped on other-endian hosts
+#define NN_FILE_PAGE 4096
+#define NN_FILE_MAX_LAYERS 256
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t precision;    // NNPrecision, the dtype of every slab
+    uint32_t input_nodes;
+    uint32_t num_layers;
+    uint32_t header_size;  // Bytes before the first slab
+    uint32_t header_crc;   // CRC-32 of the header_size bytes, this field zeroed
+    uint64_t data_size;    // Bytes of slab data after the header
+    uint32_t data_crc;     // CRC-32 of the slab data
+    uint32_t reserved;
+} NNFileHeader;
+
+typedef struct {
+    uint32_t neurons;
+    uint32_t activation;
+    uint32_t stride;       // Row length in elements
+    uint32_t reserved;
+    uint64_t offset;       // Slab position from the start of the file
+    uint64_t size;         // Slab bytes
+} NNFileLayer;
+
+static const void* layer_slab(const NNLayer* layer) {
+    return layer->precision == NN_FLOAT64 ? (const void*)layer->weights : (const void*)layer->weights_f32;
+}
+
+// Written to "<filename>.tmp" and renamed over the old file, so no reader
+// sees a torn model. On POSIX a process that has the old file mapped keeps
+// its pages; Windows cannot replace a mapped file, so there load_network
+// always copies.
 void save_network(NeuralNetwork* nn, const char* filename) {
-    FILE* file = fopen(filename, "wb");
-    if (!file) return;
+    uint64_t start = nn_stats_begin();
+    char* temp = malloc(strlen(filename) + 5);
+    if (!temp) return;
+    sprintf(temp, "%s.tmp", filename);
+    FILE* file = fopen(temp, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: cannot write '%s': %s.\n", temp, strerror(errno));
+        free(temp);
+        return;
+    }
 
-    // Header: Topology
-    fwrite(&nn->input_nodes, sizeof(int), 1, file);
-    fwrite(&nn->hidden_nodes, sizeof(int), 1, file);
-    fwrite(&nn->output_nodes, sizeof(int), 1, file);
+    // Header: Format, Topology & Slab Table
+    size_t table = sizeof(NNFileHeader) + nn->num_layers * sizeof(NNFileLayer);
+    size_t header_size = (table + NN_FILE_PAGE - 1) / NN_FILE_PAGE * NN_FILE_PAGE;
+    unsigned char* header = calloc(1, header_size);
+    if (!header) {
+        fclose(file);
+        remove(temp);
+        free(temp);
+        return;
+    }
+    NNFileHeader* h = (NNFileHeader*)header;
+    NNFileLayer* layers = (NNFileLayer*)(header + sizeof(NNFileHeader));
+    memcpy(h->magic, NN_FILE_MAGIC, 4);
+    h->version = NN_FILE_VERSION;
+    h->endian = NN_FILE_ENDIAN;
+    h->precision = (uint32_t)nn->precision;
+    h->input_nodes = (uint32_t)nn->input_nodes;
+    h->num_layers = (uint32_t)nn->num_layers;
+    h->header_size = (uint32_t)header_size;
 
-    // Body: Weights
-    for(int i = 0; i < nn->input_nodes; i++) {
-        fwrite(nn->hidden_weights[i], sizeof(double), nn->hidden_nodes, file);
+    uint64_t offset = header_size;
+    uint32_t data_crc = 0;
+    for(int l = 0; l < nn->num_layers; l++) {
+        const NNLayer* layer = &nn->layers[l];
+        size_t bytes = layer_slab_size(layer) * element_size(layer->precision);  // A multiple of 64
+        layers[l].neurons = (uint32_t)layer->neurons;
+        layers[l].activation = (uint32_t)layer->activation;
+        layers[l].stride = (uint32_t)layer->stride;
+        layers[l].offset = offset;
+        layers[l].size = bytes;
+        data_crc = crc32_update(data_crc, layer_slab(layer), bytes);
+        offset += bytes;
     }
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        fwrite(nn->output_weights[i], sizeof(double), nn->output_nodes, file);
+    h->data_size = offset - header_size;
+    h->data_crc = data_crc;
+    h->header_crc = crc32_update(0, header, header_size);
+
+    // Body: Layer Slabs as they sit in memory
+    int ok = fwrite(header, 1, header_size, file) == header_size;
+    for(int l = 0; l < nn->num_layers; l++) {
+        if (ok) ok = fwrite(layer_slab(&nn->layers[l]), 1, layers[l].size, file) == layers[l].size;
     }
-        
-    // Body: Biases
-    fwrite(nn->hidden_biases, sizeof(double), nn->hidden_nodes, file);
-    fwrite(nn->output_biases, sizeof(double), nn->output_nodes, file);
+    free(header);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: cannot write '%s': %s.\n", temp, strerror(errno));
+    else ok = nn_replace_file(temp, filename);
+    if (!ok) remove(temp);
+    free(temp);
+    nn_stats_op(NN_OP_SAVE, start, nn_stats_phase(NN_PHASE_IO, start), 1, 0);
+    if (ok) printf("Model successfully saved to '%s'\n", filename);
+}
 
-    fclose(file);
-    printf("Model successfully saved to '%s'\n", filename);
+// Validates a mapped version 3 file and builds a network whose layers point
+// into the mapping. Returns NULL with the reason in 'error'.
+static NeuralNetwork* network_from_mapping(unsigned char* base, size_t size, int verify, const char** error) {
+    NNFileHeader h;
+    *error = "not a valid model file";
+    if (size < sizeof(h)) return NULL;
+    memcpy(&h, base, sizeof(h));
+    if (h.endian != NN_FILE_ENDIAN) {
+        *error = "from a machine with a different byte order";
+        return NULL;
+    }
+    if (h.num_layers == 0 || h.num_layers > NN_FILE_MAX_LAYERS || h.input_nodes == 0 || h.input_nodes > INT32_MAX ||
+        h.precision > NN_MIXED || h.header_size % NN_FILE_PAGE != 0 ||
+        h.header_size < sizeof(h) + h.num_layers * sizeof(NNFileLayer) ||
+        h.header_size > size || h.data_size != size - h.header_size) {
+        return NULL;
+    }
+
+    // Header CRC, computed as if the CRC field were zero (without writing
+    // to the mapping, which would unshare the page)
+    static const uint32_t zero = 0;
+    size_t at = offsetof(NNFileHeader, header_crc);
+    uint32_t crc = crc32_update(0, base, at);
+    crc = crc32_update(crc, &zero, sizeof(zero));
+    crc = crc32_update(crc, base + at + sizeof(zero), h.header_size - at - sizeof(zero));
+    if (crc != h.header_crc) {
+        *error = "corrupt (header checksum mismatch)";
+        return NULL;
+    }
+    if (verify && crc32_update(0, base + h.header_size, (size_t)h.data_size) != h.data_crc) {
+        *error = "corrupt (data checksum mismatch)";
+        return NULL;
+    }
+
+    const NNFileLayer* table = (const NNFileLayer*)(base + sizeof(h));
+    int sizes[NN_FILE_MAX_LAYERS];
+    for(uint32_t l = 0; l < h.num_layers; l++) {
+        if (table[l].neurons == 0 || table[l].neurons > INT32_MAX) return NULL;
+        sizes[l] = (int)table[l].neurons;
+    }
+    NeuralNetwork* nn = network_shell(NULL, (int)h.input_nodes, (int)h.num_layers, sizes, (NNPrecision)h.precision, 0);
+    if (!nn) {
+        *error = "too large to load (out of memory)";
+        return NULL;
+    }
+
+    // Point every layer into its slab, after checking the slab table
+    size_t elem = element_size(nn->precision);
+    uint32_t pad = NN_ALIGNMENT / (uint32_t)elem;
+    int fan_in = nn->input_nodes;
+    for(int l = 0; l < nn->num_layers; l++) {
+        NNLayer* layer = &nn->layers[l];
+        const NNFileLayer* entry = &table[l];
+        layer->inputs = fan_in;
+        layer->neurons = sizes[l];
+        layer->stride = (int)entry->stride;
+        layer->precision = nn->precision;
+        layer->activation = (NNActivation)entry->activation;
+
+        size_t bytes = layer_slab_size(layer) * elem;
+        if (entry->activation > NN_ACT_LINEAR || entry->stride < (uint32_t)fan_in || entry->stride % pad != 0 ||
+            entry->offset % NN_ALIGNMENT != 0 || entry->size != bytes ||
+            entry->offset < h.header_size || entry->offset > size || bytes > size - entry->offset) {
+            free_network(nn);  // Not mapped yet: the caller unmaps
+            return NULL;
+        }
+        size_t weight_count = (size_t)layer->neurons * layer->stride;
+        if (nn->precision == NN_FLOAT64) {
+            layer->weights = (double*)(base + entry->offset);
+            layer->biases = layer->weights + weight_count;
+        } else {
+            layer->weights_f32 = (float*)(base + entry->offset);
+            layer->biases_f32 = layer->weights_f32 + weight_count;
+        }
+        fan_in = layer->neurons;
+    }
+    nn->mapping = base;
+    nn->mapping_size = size;
+    return nn;
 }
 
-NeuralNetwork* load_network(const char* filename) {
+// Original format: the int topology, then the weights in [from][to] order
+static int read_legacy_weights(NNLayer* layer, FILE* file) {
+    for(int i = 0; i < layer->inputs; i++) {
+        for(int n = 0; n < layer->neurons; n++) {
+            if (fread(&layer->weights[(size_t)n * layer->stride + i], sizeof(double), 1, file) != 1) return 0;
+        }
+    }
+    return 1;
+}
+
+// Parses a headerless file into a freshly allocated network
+static NeuralNetwork* read_network(FILE* file, const char** error) {
+    int topology[3];
+    if (fread(topology, sizeof(int), 3, file) != 3 || topology[0] <= 0 || topology[1] <= 0 || topology[2] <= 0) {
+        *error = "not a valid model file";
+        return NULL;
+    }
+
+    NeuralNetwork* nn = create_network(topology[0], topology[1], topology[2]);
+    if (!nn) {
+        *error = "too large to load (out of memory)";
+        return NULL;
+    }
+
+    NNLayer* hidden = &nn->layers[0];
+    NNLayer* output = &nn->layers[1];
+    int ok = read_legacy_weights(hidden, file) && read_legacy_weights(output, file) &&
+             fread(hidden->biases, sizeof(double), hidden->neurons, file) == (size_t)hidden->neurons &&
+             fread(output->biases, sizeof(double), output->neurons, file) == (size_t)output->neurons;
+    if (!ok) {
+        free_network(nn);
+        *error = "truncated";
+        return NULL;
+    }
+    return nn;
+}
+
+NeuralNetwork* load_network_ex(const char* filename, int flags) {
+    uint64_t start = nn_stats_begin();
+#ifdef _WIN32
+    flags |= NN_LOAD_COPY;  // A mapped file could not be replaced by save_network
+#endif
     FILE* file = fopen(filename, "rb");
     if (!file) {
         printf("Error: File '%s' not found.\n", filename);
         return NULL;
     }
 
-    int input, hidden, output;
-    fread(&input, sizeof(int), 1, file);
-    fread(&hidden, sizeof(int), 1, file);
-    fread(&output, sizeof(int), 1, file);
+    NeuralNetwork* nn = NULL;
+    const char* error = "not a valid model file";
+    char magic[4];
+    uint32_t version = 0;
+    int mappable = fread(magic, 1, 4, file) == 4 && memcmp(magic, NN_FILE_MAGIC, 4) == 0 &&
+                   fread(&version, sizeof(version), 1, file) == 1 && version == NN_FILE_VERSION;
 
-    NeuralNetwork* nn = create_network(input, hidden, output);
+    if (mappable) {
+        fclose(file);
+        size_t size = 0;
+        unsigned char* base = map_file(filename, &size);
+        if (!base) error = "not mappable";
+        else nn = network_from_mapping(base, size, flags & NN_LOAD_VERIFY, &error);
+        if (base && !nn) unmap_file(base, size);
 
-    for(int i = 0; i < nn->input_nodes; i++) {
-        fread(nn->hidden_weights[i], sizeof(double), nn->hidden_nodes, file);
-    }
-    for(int i = 0; i < nn->hidden_nodes; i++) {
-        fread(nn->output_weights[i], sizeof(double), nn->output_nodes, file);
+        // Private copy on request, e.g. so the file can be replaced
+        if (nn && (flags & NN_LOAD_COPY)) {
+            NeuralNetwork* copy = convert_network(nn, nn->precision);
+            free_network(nn);
+            nn = copy;
+            if (!nn) error = "too large to load (out of memory)";
+        }
+    } else {
+        rewind(file);
+        nn = read_network(file, &error);
+        fclose(file);
     }
-        
-    fread(nn->hidden_biases, sizeof(double), nn->hidden_nodes, file);
-    fread(nn->output_biases, sizeof(double), nn->output_nodes, file);
 
-    fclose(file);
+    if (!nn) {
+        printf("Error: '%s' is %s.\n", filename, error);
+        return NULL;
+    }
+    nn_stats_op(NN_OP_LOAD, start, nn_stats_phase(NN_PHASE_IO, start), 1, 0);
     printf("Model successfully loaded from '%s'\n", filename);
     return nn;
-}
\ No newline at end of file
+}
+
+NeuralNetwork* load_network(const char* filename) {
+    return load_network_ex(filename, 0);
+}
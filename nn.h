@@ -5,32 +5,208 @@
 #include <stdlib.h>
 #include <math.h>
 
-// Feedforward Neural Network (Input -> Hidden -> Output)
+// Weight rows start on a cache-line boundary
+#define NN_ALIGNMENT 64
+
+// Samples per tile in the batched forward pass
+#define NN_BATCH_TILE 64
+
+// Default chunk size of an arena (create_arena(0))
+#define NN_ARENA_CHUNK (64 * 1024)
+
+// Bump allocator: allocations are NN_ALIGNMENT-aligned and never freed one by
+// one; arena_reset() releases all of them at once in O(1), keeping the chunks
+// for reuse, and free_arena() returns the chunks. Not thread-safe.
+typedef struct NNArena NNArena;
+
+// Storage type of the weights, chosen when the network is created
+typedef enum {
+    NN_FLOAT64 = 0,  // double weights, double math (the default)
+    NN_FLOAT32 = 1,  // float weights, float dot products: half the memory traffic
+    NN_MIXED = 2     // float weights, dot products accumulated in double
+} NNPrecision;
+
+// Sigmoid implementation, a per-network speed/precision knob used by both
+// inference and training. The approximations compute exp() from a polynomial
+// after range reduction and vectorize; the bounds are the measured maximum
+// absolute error against the libm path.
+typedef enum {
+    NN_SIGMOID_EXACT = 0,   // libm exp (the default)
+    NN_SIGMOID_FAST = 1,    // degree-5 polynomial, max error 3e-8
+    NN_SIGMOID_FASTEST = 2  // degree-3 polynomial, max error 3e-5
+} NNSigmoidMode;
+
+// Per-layer activation. Derivatives are taken from the layer's output.
+typedef enum {
+    NN_ACT_SIGMOID = 0,  // Uses the network's NNSigmoidMode
+    NN_ACT_RELU = 1,
+    NN_ACT_TANH = 2,
+    NN_ACT_LINEAR = 3
+} NNActivation;
+
+// Dense layer: one aligned slab per layer.
+// Weights are stored row-major by destination neuron (the order the forward
+// pass walks them), each row padded to 'stride', followed by the biases.
+// Only the pointer pair matching 'precision' is set.
+typedef struct {
+    int inputs;          // Fan-in
+    int neurons;         // Fan-out
+    int stride;          // Padded row length (elements)
+    NNPrecision precision;
+    NNActivation activation;
+    double* weights;     // weights[n * stride + i]: input i -> neuron n
+    double* biases;      // biases[n], same slab, after the last row
+    float* weights_f32;  // Same layout for NN_FLOAT32 / NN_MIXED
+    float* biases_f32;
+} NNLayer;
+
+// Feedforward Neural Network: a stack of dense layers,
+// Input -> layers[0] -> ... -> layers[num_layers - 1] (the output layer)
 typedef struct {
     int input_nodes;
-    int hidden_nodes;
+    int hidden_nodes;  // Width of the first hidden layer (0 without one)
     int output_nodes;
+    NNPrecision precision;
+    NNSigmoidMode sigmoid;  // Set freely at any time; not saved with the model
 
-    // Weights
-    double** hidden_weights;
-    double** output_weights;
+    int num_layers;
+    NNLayer* layers;
 
-    // Biases
-    double* hidden_biases;
-    double* output_biases;
+    // Set when the layers live in a mapped model file (see load_network)
+    void* mapping;
+    size_t mapping_size;
+
+    // Holds this struct, the layer array and the slabs. Networks created
+    // without an arena own a private one, sized to make them one allocation.
+    NNArena* arena;
+    int owns_arena;
 } NeuralNetwork;
 
+// Reusable scratch space for predict/train, sized once from the topology.
+// One per thread: the hot path then never touches the heap.
+typedef struct {
+    int num_layers;
+
+    // Per-layer tile buffers, NN_BATCH_TILE rows of layers[l].neurons each.
+    // After a single-sample call, row 0 holds that sample's values.
+    double** acts;    // Layer outputs
+    double** deltas;  // Backprop gradients
+
+    // Float copy of the layer inputs for NN_FLOAT32 / NN_MIXED networks
+    float* scratch_f32;
+
+    // Gradient accumulators (always double), same shape as the network layers
+    NNLayer* grads;
+
+    NNArena* arena;  // Holds all of the above (private unless create_workspace_in)
+    int owns_arena;
+} NNWorkspace;
+
+// --- Weight Accessors (legacy [from][to] indexing, NN_FLOAT64 only) ---
+// 'hidden' is the first layer and 'output' the last one
+static inline double* hidden_weight(NeuralNetwork* nn, int input, int hidden) {
+    return &nn->layers[0].weights[(size_t)hidden * nn->layers[0].stride + input];
+}
+static inline double* output_weight(NeuralNetwork* nn, int hidden, int output) {
+    NNLayer* layer = &nn->layers[nn->num_layers - 1];
+    return &layer->weights[(size_t)output * layer->stride + hidden];
+}
+static inline double* hidden_bias(NeuralNetwork* nn, int hidden) { return &nn->layers[0].biases[hidden]; }
+static inline double* output_bias(NeuralNetwork* nn, int output) { return &nn->layers[nn->num_layers - 1].biases[output]; }
+
+// Precision-independent access to a layer weight (input -> neuron) or bias
+static inline double get_weight(const NNLayer* layer, int input, int neuron) {
+    size_t at = (size_t)neuron * layer->stride + input;
+    return layer->precision == NN_FLOAT64 ? layer->weights[at] : layer->weights_f32[at];
+}
+static inline void set_weight(NNLayer* layer, int input, int neuron, double value) {
+    size_t at = (size_t)neuron * layer->stride + input;
+    if (layer->precision == NN_FLOAT64) layer->weights[at] = value;
+    else layer->weights_f32[at] = (float)value;
+}
+static inline double get_bias(const NNLayer* layer, int neuron) {
+    return layer->precision == NN_FLOAT64 ? layer->biases[neuron] : layer->biases_f32[neuron];
+}
+static inline void set_bias(NNLayer* layer, int neuron, double value) {
+    if (layer->precision == NN_FLOAT64) layer->biases[neuron] = value;
+    else layer->biases_f32[neuron] = (float)value;
+}
+
+// --- Memory ---
+void* nn_aligned_alloc(size_t bytes);
+void nn_aligned_free(void* ptr);
+
+NNArena* create_arena(size_t chunk_bytes);  // 0: NN_ARENA_CHUNK
+void* arena_alloc(NNArena* arena, size_t bytes);  // NULL when out of memory
+void arena_reset(NNArena* arena);
+void free_arena(NNArena* arena);
+size_t arena_capacity(const NNArena* arena);  // Bytes held in chunks
+
+// --- System ---
+int nn_cpu_count(void);  // Online logical CPUs, at least 1
+// Moves 'temp' over 'filename' in one step (MoveFileEx on Windows, rename
+// elsewhere): readers see the old file or the new one, never a partial
+// write. 1 on success; failures are reported on stderr and 'temp' is kept.
+int nn_replace_file(const char* temp, const char* filename);
+
 // --- Lifecycle ---
-NeuralNetwork* create_network(int input, int hidden, int output);
+NeuralNetwork* create_network(int input, int hidden, int output);  // NN_FLOAT64, sigmoid
+NeuralNetwork* create_network_with_precision(int input, int hidden, int output, NNPrecision precision);
+// 'sizes' holds the width of each of the num_layers layers, the last being the
+// output layer; 'activations' may be NULL for sigmoid everywhere
+NeuralNetwork* create_layered_network(int input, int num_layers, const int* sizes,
+                                      const NNActivation* activations, NNPrecision precision);
+// Same, inside 'arena': free_network() is then a no-op and the network goes
+// away with the arena
+NeuralNetwork* create_layered_network_in(NNArena* arena, int input, int num_layers, const int* sizes,
+                                         const NNActivation* activations, NNPrecision precision);
+NeuralNetwork* convert_network(const NeuralNetwork* nn, NNPrecision precision);  // New copy
 void init_network(NeuralNetwork* nn);
 void free_network(NeuralNetwork* nn);
+size_t network_memory(const NeuralNetwork* nn);  // Bytes of weight storage (or of the mapped file)
+
+NNWorkspace* create_workspace(const NeuralNetwork* nn);
+NNWorkspace* create_workspace_in(const NeuralNetwork* nn, NNArena* arena);  // Released with the arena
+void free_workspace(NNWorkspace* ws);
+int workspace_fits(const NNWorkspace* ws, const NeuralNetwork* nn);  // Sized for this topology
 
 // --- Operations ---
-double* predict(NeuralNetwork* nn, double* inputs);
+double* predict(NeuralNetwork* nn, double* inputs);  // Caller frees the result
 void train(NeuralNetwork* nn, double* inputs, double* targets, double learning_rate);
 
+// Allocation-free variants: 'outputs' holds output_nodes values
+void predict_into(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, double* outputs);
+// Result allocated from 'arena', valid until its next reset (NULL when out of memory)
+double* predict_in(NNArena* arena, const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs);
+void train_with_workspace(NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, const double* targets, double learning_rate);
+
+// Batched inference: 'inputs' is n x input_nodes, 'outputs' is n x output_nodes (row-major)
+void predict_batch(const NeuralNetwork* nn, const double* inputs, int n, double* outputs);
+void predict_batch_with_workspace(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, int n, double* outputs);
+
+// Mini-batch gradient descent: one weight update per call, using the mean
+// gradient of the n samples (n x input_nodes inputs, n x output_nodes targets)
+void train_batch(NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, const double* targets, int n, double learning_rate);
+
+// Building blocks for custom trainers: weights += scale * accumulated gradient
+void zero_gradients(NNWorkspace* ws);
+void accumulate_gradients(const NeuralNetwork* nn, NNWorkspace* ws, const double* inputs, const double* targets, int n);
+void add_gradients(NNWorkspace* dst, const NNWorkspace* src);
+void apply_gradients(NeuralNetwork* nn, const NNWorkspace* ws, double scale);
+
 // --- Persistence ---
+// Files are page-aligned images of the layer slabs behind a checksummed
+// header (magic, version, byte order, precision, topology). load_network
+// maps them copy-on-write and uses the weights in place, so loading is O(1)
+// in model size and processes loading the same brain share its pages.
+// Headerless files from the first release are still read (and copied).
+// save_network replaces the file atomically (temporary file + rename); on
+// Windows a mapped file cannot be replaced, so there loads always copy.
+#define NN_LOAD_VERIFY 1  // Also check the CRC of the weights (reads them all)
+#define NN_LOAD_COPY 2    // Copy into private memory instead of mapping (always on Windows)
+
 void save_network(NeuralNetwork* nn, const char* filename);
 NeuralNetwork* load_network(const char* filename);
+NeuralNetwork* load_network_ex(const char* filename, int flags);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,421 @@
+#include <string.h>
+#include <errno.h>
+#include "nn_quant.h"
+#include "nn_simd.h"
+
+#define QUANT_MAX 127  // Largest quantized input and |weight|
+#define QUANT_FILE_MAGIC "CRTQ"
+#define QUANT_FILE_VERSION 2
+#define QUANT_FILE_MAX_LAYERS 256
+
+static double activate(NNActivation activation, double x) {
+    switch (activation) {
+    case NN_ACT_RELU: return x > 0.0 ? x : 0.0;
+    case NN_ACT_TANH: return tanh(x);
+    case NN_ACT_LINEAR: return x;
+    default: return 1.0 / (1.0 + exp(-x));
+    }
+}
+
+// --- Layers ---
+
+// One zeroed slab: [neurons x stride int8 weights][row_sums][scales][biases]
+static int quant_layer_alloc(NNQuantLayer* layer, int inputs, int neurons) {
+    layer->inputs = inputs;
+    layer->neurons = neurons;
+    layer->stride = (inputs + NN_ALIGNMENT - 1) / NN_ALIGNMENT * NN_ALIGNMENT;
+    layer->activation = NN_ACT_SIGMOID;
+    layer->input_scale = 1.0f / QUANT_MAX;
+    layer->input_zero_point = 0;
+
+    size_t weight_bytes = (size_t)neurons * layer->stride;
+    size_t total = weight_bytes + (size_t)neurons * (sizeof(int32_t) + 2 * sizeof(float));
+    char* slab = nn_aligned_alloc(total);
+    layer->weights = (int8_t*)slab;
+    if (!slab) return 0;
+    memset(slab, 0, total);
+
+    layer->row_sums = (int32_t*)(slab + weight_bytes);
+    layer->scales = (float*)(layer->row_sums + neurons);
+    layer->biases = layer->scales + neurons;
+    return 1;
+}
+
+static void update_row_sums(NNQuantLayer* layer) {
+    for(int n = 0; n < layer->neurons; n++) {
+        const int8_t* row = layer->weights + (size_t)n * layer->stride;
+        int32_t sum = 0;
+        for(int i = 0; i < layer->inputs; i++) sum += row[i];
+        layer->row_sums[n] = sum;
+    }
+}
+
+// Symmetric per-neuron weights: the largest |w| of each row maps to 127
+static void quantize_weights(NNQuantLayer* q, const NNLayer* layer) {
+    for(int n = 0; n < layer->neurons; n++) {
+        double max = 0.0;
+        for(int i = 0; i < layer->inputs; i++) {
+            double w = fabs(get_weight(layer, i, n));
+            if (w > max) max = w;
+        }
+        double scale = max > 0.0 ? max / QUANT_MAX : 1.0;
+        int8_t* row = q->weights + (size_t)n * q->stride;
+        for(int i = 0; i < layer->inputs; i++) {
+            row[i] = (int8_t)lrint(get_weight(layer, i, n) / scale);
+        }
+        q->scales[n] = (float)scale;
+        q->biases[n] = (float)get_bias(layer, n);
+    }
+    update_row_sums(q);
+}
+
+// Asymmetric inputs: [lo, hi] (widened to contain 0, so zero is exact) -> 0..127
+static void set_input_range(NNQuantLayer* layer, double lo, double hi) {
+    if (lo > 0.0) lo = 0.0;
+    if (hi < 0.0) hi = 0.0;
+    if (hi - lo < 1e-12) hi = lo + 1.0;
+    double scale = (hi - lo) / QUANT_MAX;
+    long zero_point = lrint(-lo / scale);
+    layer->input_scale = (float)scale;
+    layer->input_zero_point = zero_point > QUANT_MAX ? QUANT_MAX : (int)zero_point;
+}
+
+static void quantize_inputs(const NNQuantLayer* layer, const double* in, uint8_t* out) {
+    double inv = 1.0 / layer->input_scale;
+    for(int i = 0; i < layer->inputs; i++) {
+        long v = lrint(in[i] * inv) + layer->input_zero_point;
+        out[i] = (uint8_t)(v < 0 ? 0 : v > QUANT_MAX ? QUANT_MAX : v);
+    }
+}
+
+// out[n] = sigmoid(scale_x * scale_w[n] * (qx . qw[n] - zp * sum(qw[n])) + b[n])
+// for 'count' samples: each weight row is read once for the whole tile
+static void quant_layer_forward(const NNQuantLayer* layer, const NNKernels* k, const double* in, int count,
+                                uint8_t* scratch, double* out) {
+    for(int s = 0; s < count; s++) {
+        quantize_inputs(layer, in + (size_t)s * layer->inputs, scratch + (size_t)s * layer->stride);
+    }
+    for(int n = 0; n < layer->neurons; n++) {
+        const int8_t* row = layer->weights + (size_t)n * layer->stride;
+        int32_t offset = layer->input_zero_point * layer->row_sums[n];
+        double scale = (double)layer->input_scale * layer->scales[n];
+        for(int s = 0; s < count; s++) {
+            int32_t acc = k->dot_u8s8(scratch + (size_t)s * layer->stride, row, layer->inputs) - offset;
+            out[(size_t)s * layer->neurons + n] = activate(layer->activation, (double)acc * scale + layer->biases[n]);
+        }
+    }
+}
+
+// --- Lifecycle ---
+
+static NNQuantNetwork* alloc_quant_network(int input, int num_layers, const int* sizes, const NNActivation* activations) {
+    NNQuantNetwork* q = calloc(1, sizeof(NNQuantNetwork));
+    if (!q) return NULL;
+    q->layers = calloc(num_layers, sizeof(NNQuantLayer));
+    if (!q->layers) {
+        free(q);
+        return NULL;
+    }
+    q->input_nodes = input;
+    q->output_nodes = sizes[num_layers - 1];
+    q->num_layers = num_layers;
+
+    int fan_in = input;
+    for(int l = 0; l < num_layers; l++) {
+        if (!quant_layer_alloc(&q->layers[l], fan_in, sizes[l])) {
+            free_quant_network(q);
+            return NULL;
+        }
+        q->layers[l].activation = activations[l];
+        fan_in = sizes[l];
+    }
+    return q;
+}
+
+// Observed [lo, hi] of every layer's inputs over the calibration set
+static int calibrate(const NeuralNetwork* nn, const double* calibration, int n, double* lo, double* hi) {
+    NNWorkspace* ws = create_workspace(nn);
+    double* outputs = malloc(nn->output_nodes * sizeof(double));
+    if (!ws || !outputs) {
+        free(outputs);
+        free_workspace(ws);
+        return 0;
+    }
+    for(int l = 0; l < nn->num_layers; l++) {
+        lo[l] = INFINITY;
+        hi[l] = -INFINITY;
+    }
+    for(int s = 0; s < n; s++) {
+        const double* x = calibration + (size_t)s * nn->input_nodes;
+        predict_into(nn, ws, x, outputs);
+        for(int l = 0; l < nn->num_layers; l++) {
+            // Layer l is fed by the inputs or by row 0 of the previous layer
+            const double* in = l > 0 ? ws->acts[l - 1] : x;
+            for(int i = 0; i < nn->layers[l].inputs; i++) {
+                if (in[i] < lo[l]) lo[l] = in[i];
+                if (in[i] > hi[l]) hi[l] = in[i];
+            }
+        }
+    }
+    free(outputs);
+    free_workspace(ws);
+    return 1;
+}
+
+NNQuantNetwork* quantize_network(const NeuralNetwork* nn, const double* calibration, int n) {
+    int* sizes = malloc(nn->num_layers * sizeof(int));
+    NNActivation* activations = malloc(nn->num_layers * sizeof(NNActivation));
+    double* lo = malloc(2 * nn->num_layers * sizeof(double));
+    NNQuantNetwork* q = NULL;
+    if (sizes && activations && lo) {
+        for(int l = 0; l < nn->num_layers; l++) {
+            sizes[l] = nn->layers[l].neurons;
+            activations[l] = nn->layers[l].activation;
+        }
+        q = alloc_quant_network(nn->input_nodes, nn->num_layers, sizes, activations);
+    }
+
+    if (q) {
+        double* hi = lo + nn->num_layers;
+        for(int l = 0; l < nn->num_layers; l++) quantize_weights(&q->layers[l], &nn->layers[l]);
+
+        // Calibration: observed input ranges, [0, 1] without samples
+        if (n <= 0 || !calibrate(nn, calibration, n, lo, hi)) {
+            for(int l = 0; l < nn->num_layers; l++) {
+                lo[l] = 0.0;
+                hi[l] = 1.0;
+            }
+        }
+        for(int l = 0; l < nn->num_layers; l++) set_input_range(&q->layers[l], lo[l], hi[l]);
+    }
+    free(sizes);
+    free(activations);
+    free(lo);
+    return q;
+}
+
+void free_quant_network(NNQuantNetwork* q) {
+    if (!q) return;
+    for(int l = 0; l < q->num_layers; l++) nn_aligned_free(q->layers[l].weights);
+    free(q->layers);
+    free(q);
+}
+
+size_t quant_network_memory(const NNQuantNetwork* q) {
+    size_t bytes = 0;
+    for(int l = 0; l < q->num_layers; l++) {
+        const NNQuantLayer* layer = &q->layers[l];
+        bytes += (size_t)layer->neurons * layer->stride + (size_t)layer->neurons * (sizeof(int32_t) + 2 * sizeof(float));
+    }
+    return bytes;
+}
+
+// Room for a tile of QUANT_BATCH_TILE samples at the widest layer
+NNQuantWorkspace* create_quant_workspace(const NNQuantNetwork* q) {
+    NNQuantWorkspace* ws = malloc(sizeof(NNQuantWorkspace));
+    if (!ws) return NULL;
+    int widest = q->input_nodes;
+    for(int l = 0; l < q->num_layers; l++) {
+        if (q->layers[l].neurons > widest) widest = q->layers[l].neurons;
+    }
+    size_t stride = (size_t)(widest + NN_ALIGNMENT - 1) / NN_ALIGNMENT * NN_ALIGNMENT;
+    ws->quantized = nn_aligned_alloc(QUANT_BATCH_TILE * stride);
+    ws->acts[0] = nn_aligned_alloc(QUANT_BATCH_TILE * (size_t)widest * sizeof(double));
+    ws->acts[1] = nn_aligned_alloc(QUANT_BATCH_TILE * (size_t)widest * sizeof(double));
+    if (!ws->quantized || !ws->acts[0] || !ws->acts[1]) {
+        free_quant_workspace(ws);
+        return NULL;
+    }
+    return ws;
+}
+
+void free_quant_workspace(NNQuantWorkspace* ws) {
+    if (!ws) return;
+    nn_aligned_free(ws->quantized);
+    nn_aligned_free(ws->acts[0]);
+    nn_aligned_free(ws->acts[1]);
+    free(ws);
+}
+
+// --- Operations ---
+
+// Up to QUANT_BATCH_TILE samples through every layer
+static void quant_forward_tile(const NNQuantNetwork* q, NNQuantWorkspace* ws, const double* inputs, int count,
+                               double* outputs) {
+    const NNKernels* k = nn_kernels();
+    const double* in = inputs;
+    for(int l = 0; l < q->num_layers; l++) {
+        double* out = l == q->num_layers - 1 ? outputs : ws->acts[l % 2];
+        quant_layer_forward(&q->layers[l], k, in, count, ws->quantized, out);
+        in = out;
+    }
+}
+
+void quant_predict_into(const NNQuantNetwork* q, NNQuantWorkspace* ws, const double* inputs, double* outputs) {
+    quant_forward_tile(q, ws, inputs, 1, outputs);
+}
+
+void quant_predict_batch(const NNQuantNetwork* q, NNQuantWorkspace* ws, const double* inputs, int n, double* outputs) {
+    for(int s0 = 0; s0 < n; s0 += QUANT_BATCH_TILE) {
+        int count = n - s0 < QUANT_BATCH_TILE ? n - s0 : QUANT_BATCH_TILE;
+        quant_forward_tile(q, ws, inputs + (size_t)s0 * q->input_nodes, count, outputs + (size_t)s0 * q->output_nodes);
+    }
+}
+
+NNQuantReport quant_report(const NeuralNetwork* nn, const NNQuantNetwork* q, const double* inputs, int n) {
+    NNQuantReport report = {0};
+    NNWorkspace* ws = create_workspace(nn);
+    NNQuantWorkspace* qws = create_quant_workspace(q);
+    double* expected = malloc(nn->output_nodes * sizeof(double));
+    double* actual = malloc(nn->output_nodes * sizeof(double));
+
+    if (ws && qws && expected && actual) {
+        double sum = 0.0, sum_sq = 0.0;
+        for(int s = 0; s < n; s++) {
+            const double* x = inputs + (size_t)s * nn->input_nodes;
+            predict_into(nn, ws, x, expected);
+            quant_predict_into(q, qws, x, actual);
+            for(int o = 0; o < nn->output_nodes; o++) {
+                double err = fabs(expected[o] - actual[o]);
+                if (err > report.max_abs_error) report.max_abs_error = err;
+                sum += err;
+                sum_sq += err * err;
+                if ((expected[o] > 0.5) != (actual[o] > 0.5)) report.decision_flips++;
+            }
+        }
+        report.samples = n;
+        int values = n * nn->output_nodes;
+        if (values > 0) {
+            report.mean_abs_error = sum / values;
+            report.rmse = sqrt(sum_sq / values);
+        }
+    }
+    free(expected);
+    free(actual);
+    free_quant_workspace(qws);
+    free_workspace(ws);
+    return report;
+}
+
+void print_quant_report(const NNQuantReport* r) {
+    printf("Quantization report (%d samples): max error %.5f, mean %.5f, RMSE %.5f, %d decision flip(s)\n",
+           r->samples, r->max_abs_error, r->mean_abs_error, r->rmse, r->decision_flips);
+}
+
+// --- Persistence (I/O) ---
+
+// File layout: "CRTQ", int version, int input, int num_layers,
+// num_layers x (int neurons, int activation), then per layer: float input
+// scale, int zero point, int8 weight rows (unpadded), float scales, float
+// biases.
+static int write_quant_layer(const NNQuantLayer* layer, FILE* file) {
+    if (fwrite(&layer->input_scale, sizeof(float), 1, file) != 1) return 0;
+    if (fwrite(&layer->input_zero_point, sizeof(int), 1, file) != 1) return 0;
+    for(int n = 0; n < layer->neurons; n++) {
+        if (fwrite(layer->weights + (size_t)n * layer->stride, 1, layer->inputs, file) != (size_t)layer->inputs) return 0;
+    }
+    if (fwrite(layer->scales, sizeof(float), layer->neurons, file) != (size_t)layer->neurons) return 0;
+    return fwrite(layer->biases, sizeof(float), layer->neurons, file) == (size_t)layer->neurons;
+}
+
+static int read_quant_layer(NNQuantLayer* layer, FILE* file) {
+    if (fread(&layer->input_scale, sizeof(float), 1, file) != 1) return 0;
+    if (fread(&layer->input_zero_point, sizeof(int), 1, file) != 1) return 0;
+    if (layer->input_zero_point < 0 || layer->input_zero_point > QUANT_MAX) return 0;
+    for(int n = 0; n < layer->neurons; n++) {
+        if (fread(layer->weights + (size_t)n * layer->stride, 1, layer->inputs, file) != (size_t)layer->inputs) return 0;
+    }
+    if (fread(layer->scales, sizeof(float), layer->neurons, file) != (size_t)layer->neurons) return 0;
+    if (fread(layer->biases, sizeof(float), layer->neurons, file) != (size_t)layer->neurons) return 0;
+    update_row_sums(layer);
+    return 1;
+}
+
+// Written to '<filename>.tmp' and moved into place, like save_network
+int save_quant_network(const NNQuantNetwork* q, const char* filename) {
+    char* temp = malloc(strlen(filename) + 5);
+    if (!temp) return 0;
+    sprintf(temp, "%s.tmp", filename);
+    FILE* file = fopen(temp, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: cannot write '%s': %s.\n", temp, strerror(errno));
+        free(temp);
+        return 0;
+    }
+
+    int header[3] = { QUANT_FILE_VERSION, q->input_nodes, q->num_layers };
+    int ok = fwrite(QUANT_FILE_MAGIC, 1, 4, file) == 4 && fwrite(header, sizeof(int), 3, file) == 3;
+    for(int l = 0; ok && l < q->num_layers; l++) {
+        int shape[2] = { q->layers[l].neurons, (int)q->layers[l].activation };
+        ok = fwrite(shape, sizeof(int), 2, file) == 2;
+    }
+    for(int l = 0; ok && l < q->num_layers; l++) ok = write_quant_layer(&q->layers[l], file);
+
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: cannot write '%s': %s.\n", temp, strerror(errno));
+    else ok = nn_replace_file(temp, filename);
+    if (!ok) remove(temp);
+    free(temp);
+    if (ok) printf("Quantized model saved to '%s'\n", filename);
+    return ok;
+}
+
+// Topology from the header; 0 if it is not a valid quantized model
+static int read_quant_header(FILE* file, int* input, int* num_layers, int* sizes, NNActivation* activations) {
+    char magic[4];
+    int header[3];
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, QUANT_FILE_MAGIC, 4) != 0) return 0;
+    if (fread(header, sizeof(int), 3, file) != 3) return 0;
+    if (header[0] != QUANT_FILE_VERSION) return 0;
+    *input = header[1];
+    *num_layers = header[2];
+    if (*num_layers <= 0 || *num_layers > QUANT_FILE_MAX_LAYERS) return 0;
+    for(int l = 0; l < *num_layers; l++) {
+        int shape[2];
+        if (fread(shape, sizeof(int), 2, file) != 2) return 0;
+        if (shape[1] < NN_ACT_SIGMOID || shape[1] > NN_ACT_LINEAR) return 0;
+        sizes[l] = shape[0];
+        activations[l] = (NNActivation)shape[1];
+    }
+
+    if (*input <= 0) return 0;
+    for(int l = 0; l < *num_layers; l++) {
+        if (sizes[l] <= 0) return 0;
+    }
+    return 1;
+}
+
+NNQuantNetwork* load_quant_network(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        printf("Error: File '%s' not found.\n", filename);
+        return NULL;
+    }
+
+    int input, num_layers;
+    int sizes[QUANT_FILE_MAX_LAYERS];
+    NNActivation activations[QUANT_FILE_MAX_LAYERS];
+    if (!read_quant_header(file, &input, &num_layers, sizes, activations)) {
+        fclose(file);
+        printf("Error: '%s' is not a quantized model file.\n", filename);
+        return NULL;
+    }
+
+    NNQuantNetwork* q = alloc_quant_network(input, num_layers, sizes, activations);
+    if (!q) {
+        fclose(file);
+        printf("Error: Out of memory loading '%s'.\n", filename);
+        return NULL;
+    }
+    int ok = 1;
+    for(int l = 0; ok && l < num_layers; l++) ok = read_quant_layer(&q->layers[l], file);
+    fclose(file);
+    if (!ok) {
+        free_quant_network(q);
+        printf("Error: '%s' is truncated.\n", filename);
+        return NULL;
+    }
+
+    printf("Quantized model loaded from '%s'\n", filename);
+    return q;
+}
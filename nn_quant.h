@@ -0,0 +1,76 @@
+#ifndef NN_QUANT_H
+#define NN_QUANT_H
+
+#include <stdint.h>
+#include "nn.h"
+
+// Int8 post-training quantization for inference-only brains.
+//
+// Weights are int8 with one scale per neuron (w = q * scale). Layer inputs
+// are quantized to 0..127 with a per-layer scale and zero point found by
+// calibration (x = (q - zero_point) * scale); 7 bits keep the AVX2
+// multiply-add from saturating. Dot products accumulate in int32, biases and
+// the activation stay in floating point.
+typedef struct {
+    int inputs;
+    int neurons;
+    int stride;           // Padded row length (bytes)
+    NNActivation activation;
+    int8_t* weights;      // weights[n * stride + i]: input i -> neuron n
+    int32_t* row_sums;    // sum of each weight row, folds in the zero point
+    float* scales;        // Per-neuron weight scale
+    float* biases;
+    float input_scale;    // Input quantization, from calibration
+    int input_zero_point;
+} NNQuantLayer;
+
+#define QUANT_BATCH_TILE NN_BATCH_TILE  // Samples per pass over the weights in quant_predict_batch
+
+// Same layer stack as the source network
+typedef struct {
+    int input_nodes;
+    int output_nodes;
+
+    int num_layers;
+    NNQuantLayer* layers;
+} NNQuantNetwork;
+
+// Scratch space for quantized inference, one per thread
+typedef struct {
+    uint8_t* quantized;  // Quantized layer inputs, a tile of rows
+    double* acts[2];     // Layer outputs for a tile, alternating between layers
+} NNQuantWorkspace;
+
+// Agreement between a float network and its quantized copy
+typedef struct {
+    int samples;
+    double max_abs_error;
+    double mean_abs_error;
+    double rmse;
+    int decision_flips;  // Outputs on opposite sides of 0.5
+} NNQuantReport;
+
+// --- Lifecycle ---
+// 'calibration' is n x input_nodes representative inputs. With n == 0 the
+// layer inputs are assumed to lie in [0, 1] (normalized features, sigmoids).
+// Sigmoid layers use the exact sigmoid regardless of nn->sigmoid.
+NNQuantNetwork* quantize_network(const NeuralNetwork* nn, const double* calibration, int n);
+void free_quant_network(NNQuantNetwork* q);
+size_t quant_network_memory(const NNQuantNetwork* q);  // Bytes of weight storage, as network_memory
+
+NNQuantWorkspace* create_quant_workspace(const NNQuantNetwork* q);
+void free_quant_workspace(NNQuantWorkspace* ws);
+
+// --- Operations ---
+void quant_predict_into(const NNQuantNetwork* q, NNQuantWorkspace* ws, const double* inputs, double* outputs);
+void quant_predict_batch(const NNQuantNetwork* q, NNQuantWorkspace* ws, const double* inputs, int n, double* outputs);
+
+// Compare against the float model on n x input_nodes inputs
+NNQuantReport quant_report(const NeuralNetwork* nn, const NNQuantNetwork* q, const double* inputs, int n);
+void print_quant_report(const NNQuantReport* report);
+
+// --- Persistence ---
+int save_quant_network(const NNQuantNetwork* q, const char* filename);  // 1 on success, errors on stderr
+NNQuantNetwork* load_quant_network(const char* filename);
+
+#endif
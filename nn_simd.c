@@ -0,0 +1,541 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "nn_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NN_X86 1
+#include <immintrin.h>
+#endif
+
+/* =============================================================
+   SCALAR (reference order, also the non-x86 path)
+   ============================================================= */
+
+static double dot_scalar(const double* a, const double* b, int n) {
+    double sum = 0.0;
+    for(int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static void dot4_scalar(const double* x, const double* w, int ldw, int n, double out[4]) {
+    for(int r = 0; r < 4; r++) out[r] = dot_scalar(x, w + (size_t)r * ldw, n);
+}
+
+// Register-blocked: each weight load is reused across four samples and vice versa
+static void gemm4x4_scalar(const double* x, int ldx, const double* w, int ldw, int n, double out[4][4]) {
+    const double *w0 = w, *w1 = w + ldw, *w2 = w + 2 * ldw, *w3 = w + 3 * ldw;
+    const double *x0 = x, *x1 = x + ldx, *x2 = x + 2 * ldx, *x3 = x + 3 * ldx;
+    double acc[4][4] = {{0.0}};
+    for(int i = 0; i < n; i++) {
+        double a0 = x0[i], a1 = x1[i], a2 = x2[i], a3 = x3[i];
+        double b0 = w0[i], b1 = w1[i], b2 = w2[i], b3 = w3[i];
+        acc[0][0] += a0 * b0; acc[0][1] += a0 * b1; acc[0][2] += a0 * b2; acc[0][3] += a0 * b3;
+        acc[1][0] += a1 * b0; acc[1][1] += a1 * b1; acc[1][2] += a1 * b2; acc[1][3] += a1 * b3;
+        acc[2][0] += a2 * b0; acc[2][1] += a2 * b1; acc[2][2] += a2 * b2; acc[2][3] += a2 * b3;
+        acc[3][0] += a3 * b0; acc[3][1] += a3 * b1; acc[3][2] += a3 * b2; acc[3][3] += a3 * b3;
+    }
+    memcpy(out, acc, sizeof(acc));
+}
+
+static void axpy_scalar(double* y, double alpha, const double* x, size_t n) {
+    for(size_t i = 0; i < n; i++) y[i] += alpha * x[i];
+}
+
+static void mul_deriv_scalar(double* d, const double* act, int n) {
+    for(int i = 0; i < n; i++) d[i] *= act[i] * (1.0 - act[i]);
+}
+
+static float dot_f32_scalar(const float* a, const float* b, int n) {
+    float sum = 0.0f;
+    for(int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static double dot_f32_acc64_scalar(const float* a, const float* b, int n) {
+    double sum = 0.0;
+    for(int i = 0; i < n; i++) sum += (double)a[i] * b[i];
+    return sum;
+}
+
+static int32_t dot_u8s8_scalar(const uint8_t* x, const int8_t* w, int n) {
+    int32_t sum = 0;
+    for(int i = 0; i < n; i++) sum += x[i] * w[i];
+    return sum;
+}
+
+// Polynomial sigmoid: exp(-x) = 2^k * 2^f with k = round(-x * log2(e)),
+// |f| <= 0.5, and 2^f from the caller's coefficients (Horner, c[0] first).
+// Every level follows these steps, with |x * log2(e)| clamped to 60.
+#define SIGMOID_LOG2E 1.4426950408889634
+#define SIGMOID_CLAMP 60.0
+
+static double pow2_int(int k) {
+    uint64_t bits = (uint64_t)(k + 1023) << 52;
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static void sigmoid_poly_scalar(double* x, int n, const double* c, int degree) {
+    for(int i = 0; i < n; i++) {
+        double t = -x[i] * SIGMOID_LOG2E;
+        t = t < -SIGMOID_CLAMP ? -SIGMOID_CLAMP : t > SIGMOID_CLAMP ? SIGMOID_CLAMP : t;
+        double k = nearbyint(t), f = t - k;
+        double p = c[degree];
+        for(int d = degree - 1; d >= 0; d--) p = p * f + c[d];
+        x[i] = 1.0 / (1.0 + p * pow2_int((int)k));
+    }
+}
+
+static const NNKernels kernels_scalar = {
+    "scalar", dot_scalar, dot4_scalar, gemm4x4_scalar, axpy_scalar, mul_deriv_scalar,
+    dot_f32_scalar, dot_f32_acc64_scalar, dot_u8s8_scalar, sigmoid_poly_scalar
+};
+
+#ifdef NN_X86
+
+/* =============================================================
+   SSE2 (2 lanes)
+   ============================================================= */
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+// Lanes are folded left to right, then the tail is added in order
+TARGET_SSE2 static inline double finish_sse2(__m128d v, const double* a, const double* b, int from, int n) {
+    double t[2];
+    _mm_storeu_pd(t, v);
+    double sum = t[0] + t[1];
+    for(int i = from; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_SSE2 static double dot_sse2(const double* a, const double* b, int n) {
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+    for(; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    return finish_sse2(acc, a, b, i, n);
+}
+
+TARGET_SSE2 static void dot4_sse2(const double* x, const double* w, int ldw, int n, double out[4]) {
+    __m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+    int i = 0;
+    for(; i + 2 <= n; i += 2) {
+        __m128d xv = _mm_loadu_pd(x + i);
+        for(int r = 0; r < 4; r++) {
+            acc[r] = _mm_add_pd(acc[r], _mm_mul_pd(xv, _mm_loadu_pd(w + (size_t)r * ldw + i)));
+        }
+    }
+    for(int r = 0; r < 4; r++) out[r] = finish_sse2(acc[r], x, w + (size_t)r * ldw, i, n);
+}
+
+TARGET_SSE2 static void gemm4x4_sse2(const double* x, int ldx, const double* w, int ldw, int n, double out[4][4]) {
+    for(int s = 0; s < 4; s++) dot4_sse2(x + (size_t)s * ldx, w, ldw, n, out[s]);
+}
+
+TARGET_SSE2 static void axpy_sse2(double* y, double alpha, const double* x, size_t n) {
+    __m128d a = _mm_set1_pd(alpha);
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+    }
+    for(; i < n; i++) y[i] += alpha * x[i];
+}
+
+TARGET_SSE2 static void mul_deriv_sse2(double* d, const double* act, int n) {
+    __m128d one = _mm_set1_pd(1.0);
+    int i = 0;
+    for(; i + 2 <= n; i += 2) {
+        __m128d a = _mm_loadu_pd(act + i);
+        _mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(d + i), _mm_mul_pd(a, _mm_sub_pd(one, a))));
+    }
+    for(; i < n; i++) d[i] *= act[i] * (1.0 - act[i]);
+}
+
+TARGET_SSE2 static float dot_f32_sse2(const float* a, const float* b, int n) {
+    __m128 acc = _mm_setzero_ps();
+    int i = 0;
+    for(; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    float t[4];
+    _mm_storeu_ps(t, acc);
+    float sum = ((t[0] + t[1]) + t[2]) + t[3];
+    for(; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+// Products are formed from the widened floats, so they are exact in double
+TARGET_SSE2 static double dot_f32_acc64_sse2(const float* a, const float* b, int n) {
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_cvtps_pd(va), _mm_cvtps_pd(vb)));
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(va, va)), _mm_cvtps_pd(_mm_movehl_ps(vb, vb))));
+    }
+    double t[2];
+    _mm_storeu_pd(t, acc);
+    double sum = t[0] + t[1];
+    for(; i < n; i++) sum += (double)a[i] * b[i];
+    return sum;
+}
+
+// Widen to int16 (zero-extend x, sign-extend w), then pairwise multiply-add
+TARGET_SSE2 static int32_t dot_u8s8_sse2(const uint8_t* x, const int8_t* w, int n) {
+    __m128i acc = _mm_setzero_si128(), zero = _mm_setzero_si128();
+    int i = 0;
+    for(; i + 16 <= n; i += 16) {
+        __m128i xv = _mm_loadu_si128((const __m128i*)(x + i));
+        __m128i wv = _mm_loadu_si128((const __m128i*)(w + i));
+        __m128i wlo = _mm_srai_epi16(_mm_unpacklo_epi8(wv, wv), 8);
+        __m128i whi = _mm_srai_epi16(_mm_unpackhi_epi8(wv, wv), 8);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(xv, zero), wlo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(xv, zero), whi));
+    }
+    int32_t t[4];
+    _mm_storeu_si128((__m128i*)t, acc);
+    int32_t sum = t[0] + t[1] + t[2] + t[3];
+    for(; i < n; i++) sum += x[i] * w[i];
+    return sum;
+}
+
+TARGET_SSE2 static void sigmoid_poly_sse2(double* x, int n, const double* c, int degree) {
+    __m128d log2e = _mm_set1_pd(-SIGMOID_LOG2E), one = _mm_set1_pd(1.0);
+    __m128d lo = _mm_set1_pd(-SIGMOID_CLAMP), hi = _mm_set1_pd(SIGMOID_CLAMP);
+    __m128i bias = _mm_set1_epi32(1023);
+    int i = 0;
+    for(; i + 2 <= n; i += 2) {
+        __m128d t = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(x + i), log2e), lo), hi);
+        __m128i k = _mm_cvtpd_epi32(t);  // Round to nearest
+        __m128d f = _mm_sub_pd(t, _mm_cvtepi32_pd(k));
+        __m128d p = _mm_set1_pd(c[degree]);
+        for(int d = degree - 1; d >= 0; d--) p = _mm_add_pd(_mm_mul_pd(p, f), _mm_set1_pd(c[d]));
+        __m128i e = _mm_slli_epi64(_mm_unpacklo_epi32(_mm_add_epi32(k, bias), _mm_setzero_si128()), 52);
+        p = _mm_mul_pd(p, _mm_castsi128_pd(e));
+        _mm_storeu_pd(x + i, _mm_div_pd(one, _mm_add_pd(one, p)));
+    }
+    sigmoid_poly_scalar(x + i, n - i, c, degree);
+}
+
+static const NNKernels kernels_sse2 = {
+    "sse2", dot_sse2, dot4_sse2, gemm4x4_sse2, axpy_sse2, mul_deriv_sse2,
+    dot_f32_sse2, dot_f32_acc64_sse2, dot_u8s8_sse2, sigmoid_poly_sse2
+};
+
+/* =============================================================
+   AVX2 + FMA (4 lanes)
+   ============================================================= */
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+
+TARGET_AVX2 static inline double finish_avx2(__m256d v, const double* a, const double* b, int from, int n) {
+    double t[4];
+    _mm256_storeu_pd(t, v);
+    double sum = ((t[0] + t[1]) + t[2]) + t[3];
+    for(int i = from; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_AVX2 static double dot_avx2(const double* a, const double* b, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4) acc = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc);
+    return finish_avx2(acc, a, b, i, n);
+}
+
+TARGET_AVX2 static void dot4_avx2(const double* x, const double* w, int ldw, int n, double out[4]) {
+    const double *w0 = w, *w1 = w + ldw, *w2 = w + 2 * ldw, *w3 = w + 3 * ldw;
+    __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+    __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256d xv = _mm256_loadu_pd(x + i);
+        a0 = _mm256_fmadd_pd(xv, _mm256_loadu_pd(w0 + i), a0);
+        a1 = _mm256_fmadd_pd(xv, _mm256_loadu_pd(w1 + i), a1);
+        a2 = _mm256_fmadd_pd(xv, _mm256_loadu_pd(w2 + i), a2);
+        a3 = _mm256_fmadd_pd(xv, _mm256_loadu_pd(w3 + i), a3);
+    }
+    out[0] = finish_avx2(a0, x, w0, i, n);
+    out[1] = finish_avx2(a1, x, w1, i, n);
+    out[2] = finish_avx2(a2, x, w2, i, n);
+    out[3] = finish_avx2(a3, x, w3, i, n);
+}
+
+// Two samples x four rows per pass: 8 accumulators fit the 16 ymm registers
+TARGET_AVX2 static void gemm4x4_avx2(const double* x, int ldx, const double* w, int ldw, int n, double out[4][4]) {
+    const double *w0 = w, *w1 = w + ldw, *w2 = w + 2 * ldw, *w3 = w + 3 * ldw;
+    for(int s = 0; s < 4; s += 2) {
+        const double* xa = x + (size_t)s * ldx;
+        const double* xb = xa + ldx;
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d a2 = _mm256_setzero_pd(), a3 = _mm256_setzero_pd();
+        __m256d b0 = _mm256_setzero_pd(), b1 = _mm256_setzero_pd();
+        __m256d b2 = _mm256_setzero_pd(), b3 = _mm256_setzero_pd();
+        int i = 0;
+        for(; i + 4 <= n; i += 4) {
+            __m256d va = _mm256_loadu_pd(xa + i), vb = _mm256_loadu_pd(xb + i);
+            __m256d r0 = _mm256_loadu_pd(w0 + i), r1 = _mm256_loadu_pd(w1 + i);
+            __m256d r2 = _mm256_loadu_pd(w2 + i), r3 = _mm256_loadu_pd(w3 + i);
+            a0 = _mm256_fmadd_pd(va, r0, a0); b0 = _mm256_fmadd_pd(vb, r0, b0);
+            a1 = _mm256_fmadd_pd(va, r1, a1); b1 = _mm256_fmadd_pd(vb, r1, b1);
+            a2 = _mm256_fmadd_pd(va, r2, a2); b2 = _mm256_fmadd_pd(vb, r2, b2);
+            a3 = _mm256_fmadd_pd(va, r3, a3); b3 = _mm256_fmadd_pd(vb, r3, b3);
+        }
+        out[s][0] = finish_avx2(a0, xa, w0, i, n); out[s + 1][0] = finish_avx2(b0, xb, w0, i, n);
+        out[s][1] = finish_avx2(a1, xa, w1, i, n); out[s + 1][1] = finish_avx2(b1, xb, w1, i, n);
+        out[s][2] = finish_avx2(a2, xa, w2, i, n); out[s + 1][2] = finish_avx2(b2, xb, w2, i, n);
+        out[s][3] = finish_avx2(a3, xa, w3, i, n); out[s + 1][3] = finish_avx2(b3, xb, w3, i, n);
+    }
+}
+
+TARGET_AVX2 static void axpy_avx2(double* y, double alpha, const double* x, size_t n) {
+    __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    for(; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for(; i < n; i++) y[i] += alpha * x[i];
+}
+
+TARGET_AVX2 static void mul_deriv_avx2(double* d, const double* act, int n) {
+    __m256d one = _mm256_set1_pd(1.0);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256d a = _mm256_loadu_pd(act + i);
+        _mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(d + i), _mm256_mul_pd(a, _mm256_sub_pd(one, a))));
+    }
+    for(; i < n; i++) d[i] *= act[i] * (1.0 - act[i]);
+}
+
+TARGET_AVX2 static float dot_f32_avx2(const float* a, const float* b, int n) {
+    __m256 acc = _mm256_setzero_ps();
+    int i = 0;
+    for(; i + 8 <= n; i += 8) acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+    float t[8];
+    _mm256_storeu_ps(t, acc);
+    float sum = ((((((t[0] + t[1]) + t[2]) + t[3]) + t[4]) + t[5]) + t[6]) + t[7];
+    for(; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_AVX2 static double dot_f32_acc64_avx2(const float* a, const float* b, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256d va = _mm256_cvtps_pd(_mm_loadu_ps(a + i));
+        __m256d vb = _mm256_cvtps_pd(_mm_loadu_ps(b + i));
+        acc = _mm256_fmadd_pd(va, vb, acc);
+    }
+    double t[4];
+    _mm256_storeu_pd(t, acc);
+    double sum = ((t[0] + t[1]) + t[2]) + t[3];
+    for(; i < n; i++) sum += (double)a[i] * b[i];
+    return sum;
+}
+
+// u8 x s8 -> pairwise int16 sums (x <= 127 keeps them from saturating) -> int32
+TARGET_AVX2 static int32_t dot_u8s8_avx2(const uint8_t* x, const int8_t* w, int n) {
+    __m256i acc = _mm256_setzero_si256(), ones = _mm256_set1_epi16(1);
+    int i = 0;
+    for(; i + 32 <= n; i += 32) {
+        __m256i p = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(x + i)),
+                                         _mm256_loadu_si256((const __m256i*)(w + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p, ones));
+    }
+    int32_t t[8];
+    _mm256_storeu_si256((__m256i*)t, acc);
+    int32_t sum = t[0] + t[1] + t[2] + t[3] + t[4] + t[5] + t[6] + t[7];
+    for(; i < n; i++) sum += x[i] * w[i];
+    return sum;
+}
+
+TARGET_AVX2 static void sigmoid_poly_avx2(double* x, int n, const double* c, int degree) {
+    __m256d log2e = _mm256_set1_pd(-SIGMOID_LOG2E), one = _mm256_set1_pd(1.0);
+    __m256d lo = _mm256_set1_pd(-SIGMOID_CLAMP), hi = _mm256_set1_pd(SIGMOID_CLAMP);
+    __m128i bias = _mm_set1_epi32(1023);
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m256d t = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_loadu_pd(x + i), log2e), lo), hi);
+        __m256d k = _mm256_round_pd(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d f = _mm256_sub_pd(t, k);
+        __m256d p = _mm256_set1_pd(c[degree]);
+        for(int d = degree - 1; d >= 0; d--) p = _mm256_fmadd_pd(p, f, _mm256_set1_pd(c[d]));
+        __m256i e = _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm_add_epi32(_mm256_cvtpd_epi32(k), bias)), 52);
+        p = _mm256_mul_pd(p, _mm256_castsi256_pd(e));
+        _mm256_storeu_pd(x + i, _mm256_div_pd(one, _mm256_add_pd(one, p)));
+    }
+    sigmoid_poly_scalar(x + i, n - i, c, degree);
+}
+
+static const NNKernels kernels_avx2 = {
+    "avx2", dot_avx2, dot4_avx2, gemm4x4_avx2, axpy_avx2, mul_deriv_avx2,
+    dot_f32_avx2, dot_f32_acc64_avx2, dot_u8s8_avx2, sigmoid_poly_avx2
+};
+
+/* =============================================================
+   AVX-512 (8 lanes)
+   ============================================================= */
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+
+TARGET_AVX512 static inline double finish_avx512(__m512d v, const double* a, const double* b, int from, int n) {
+    double t[8];
+    _mm512_storeu_pd(t, v);
+    double sum = ((((((t[0] + t[1]) + t[2]) + t[3]) + t[4]) + t[5]) + t[6]) + t[7];
+    for(int i = from; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_AVX512 static double dot_avx512(const double* a, const double* b, int n) {
+    __m512d acc = _mm512_setzero_pd();
+    int i = 0;
+    for(; i + 8 <= n; i += 8) acc = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc);
+    return finish_avx512(acc, a, b, i, n);
+}
+
+TARGET_AVX512 static void dot4_avx512(const double* x, const double* w, int ldw, int n, double out[4]) {
+    const double *w0 = w, *w1 = w + ldw, *w2 = w + 2 * ldw, *w3 = w + 3 * ldw;
+    __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+    __m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m512d xv = _mm512_loadu_pd(x + i);
+        a0 = _mm512_fmadd_pd(xv, _mm512_loadu_pd(w0 + i), a0);
+        a1 = _mm512_fmadd_pd(xv, _mm512_loadu_pd(w1 + i), a1);
+        a2 = _mm512_fmadd_pd(xv, _mm512_loadu_pd(w2 + i), a2);
+        a3 = _mm512_fmadd_pd(xv, _mm512_loadu_pd(w3 + i), a3);
+    }
+    out[0] = finish_avx512(a0, x, w0, i, n);
+    out[1] = finish_avx512(a1, x, w1, i, n);
+    out[2] = finish_avx512(a2, x, w2, i, n);
+    out[3] = finish_avx512(a3, x, w3, i, n);
+}
+
+// Two samples x four rows per pass, same shape as the AVX2 kernel
+TARGET_AVX512 static void gemm4x4_avx512(const double* x, int ldx, const double* w, int ldw, int n, double out[4][4]) {
+    const double *w0 = w, *w1 = w + ldw, *w2 = w + 2 * ldw, *w3 = w + 3 * ldw;
+    for(int s = 0; s < 4; s += 2) {
+        const double* xa = x + (size_t)s * ldx;
+        const double* xb = xa + ldx;
+        __m512d a0 = _mm512_setzero_pd(), a1 = _mm512_setzero_pd();
+        __m512d a2 = _mm512_setzero_pd(), a3 = _mm512_setzero_pd();
+        __m512d b0 = _mm512_setzero_pd(), b1 = _mm512_setzero_pd();
+        __m512d b2 = _mm512_setzero_pd(), b3 = _mm512_setzero_pd();
+        int i = 0;
+        for(; i + 8 <= n; i += 8) {
+            __m512d va = _mm512_loadu_pd(xa + i), vb = _mm512_loadu_pd(xb + i);
+            __m512d r0 = _mm512_loadu_pd(w0 + i), r1 = _mm512_loadu_pd(w1 + i);
+            __m512d r2 = _mm512_loadu_pd(w2 + i), r3 = _mm512_loadu_pd(w3 + i);
+            a0 = _mm512_fmadd_pd(va, r0, a0); b0 = _mm512_fmadd_pd(vb, r0, b0);
+            a1 = _mm512_fmadd_pd(va, r1, a1); b1 = _mm512_fmadd_pd(vb, r1, b1);
+            a2 = _mm512_fmadd_pd(va, r2, a2); b2 = _mm512_fmadd_pd(vb, r2, b2);
+            a3 = _mm512_fmadd_pd(va, r3, a3); b3 = _mm512_fmadd_pd(vb, r3, b3);
+        }
+        out[s][0] = finish_avx512(a0, xa, w0, i, n); out[s + 1][0] = finish_avx512(b0, xb, w0, i, n);
+        out[s][1] = finish_avx512(a1, xa, w1, i, n); out[s + 1][1] = finish_avx512(b1, xb, w1, i, n);
+        out[s][2] = finish_avx512(a2, xa, w2, i, n); out[s + 1][2] = finish_avx512(b2, xb, w2, i, n);
+        out[s][3] = finish_avx512(a3, xa, w3, i, n); out[s + 1][3] = finish_avx512(b3, xb, w3, i, n);
+    }
+}
+
+TARGET_AVX512 static void axpy_avx512(double* y, double alpha, const double* x, size_t n) {
+    __m512d a = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    for(; i < n; i++) y[i] += alpha * x[i];
+}
+
+TARGET_AVX512 static void mul_deriv_avx512(double* d, const double* act, int n) {
+    __m512d one = _mm512_set1_pd(1.0);
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m512d a = _mm512_loadu_pd(act + i);
+        _mm512_storeu_pd(d + i, _mm512_mul_pd(_mm512_loadu_pd(d + i), _mm512_mul_pd(a, _mm512_sub_pd(one, a))));
+    }
+    for(; i < n; i++) d[i] *= act[i] * (1.0 - act[i]);
+}
+
+TARGET_AVX512 static float dot_f32_avx512(const float* a, const float* b, int n) {
+    __m512 acc = _mm512_setzero_ps();
+    int i = 0;
+    for(; i + 16 <= n; i += 16) acc = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc);
+    float t[16];
+    _mm512_storeu_ps(t, acc);
+    float sum = t[0];
+    for(int l = 1; l < 16; l++) sum += t[l];
+    for(; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+TARGET_AVX512 static double dot_f32_acc64_avx512(const float* a, const float* b, int n) {
+    __m512d acc = _mm512_setzero_pd();
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m512d va = _mm512_cvtps_pd(_mm256_loadu_ps(a + i));
+        __m512d vb = _mm512_cvtps_pd(_mm256_loadu_ps(b + i));
+        acc = _mm512_fmadd_pd(va, vb, acc);
+    }
+    double t[8];
+    _mm512_storeu_pd(t, acc);
+    double sum = ((((((t[0] + t[1]) + t[2]) + t[3]) + t[4]) + t[5]) + t[6]) + t[7];
+    for(; i < n; i++) sum += (double)a[i] * b[i];
+    return sum;
+}
+
+TARGET_AVX512 static void sigmoid_poly_avx512(double* x, int n, const double* c, int degree) {
+    __m512d log2e = _mm512_set1_pd(-SIGMOID_LOG2E), one = _mm512_set1_pd(1.0);
+    __m512d lo = _mm512_set1_pd(-SIGMOID_CLAMP), hi = _mm512_set1_pd(SIGMOID_CLAMP);
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m512d t = _mm512_min_pd(_mm512_max_pd(_mm512_mul_pd(_mm512_loadu_pd(x + i), log2e), lo), hi);
+        __m512d k = _mm512_roundscale_pd(t, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512d f = _mm512_sub_pd(t, k);
+        __m512d p = _mm512_set1_pd(c[degree]);
+        for(int d = degree - 1; d >= 0; d--) p = _mm512_fmadd_pd(p, f, _mm512_set1_pd(c[d]));
+        p = _mm512_scalef_pd(p, k);  // p * 2^k
+        _mm512_storeu_pd(x + i, _mm512_div_pd(one, _mm512_add_pd(one, p)));
+    }
+    sigmoid_poly_scalar(x + i, n - i, c, degree);
+}
+
+static const NNKernels kernels_avx512 = {
+    "avx512", dot_avx512, dot4_avx512, gemm4x4_avx512, axpy_avx512, mul_deriv_avx512,
+    dot_f32_avx512, dot_f32_acc64_avx512,
+    dot_u8s8_avx2,  // Integer sums are exact; AVX-512F has no byte multiply-add
+    sigmoid_poly_avx512
+};
+
+#endif
+
+/* =============================================================
+   RUNTIME DISPATCH
+   ============================================================= */
+
+static const NNKernels* active_kernels = &kernels_scalar;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+static void select_kernels(void) {
+#ifdef NN_X86
+    // Optional cap from the environment, e.g. CORTEX_SIMD=sse2
+    const char* cap = getenv("CORTEX_SIMD");
+    int level = 3;
+    if (cap) {
+        if (strcmp(cap, "scalar") == 0) level = 0;
+        else if (strcmp(cap, "sse2") == 0) level = 1;
+        else if (strcmp(cap, "avx2") == 0) level = 2;
+    }
+
+    __builtin_cpu_init();
+    if (level >= 3 && __builtin_cpu_supports("avx512f")) active_kernels = &kernels_avx512;
+    else if (level >= 2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) active_kernels = &kernels_avx2;
+    else if (level >= 1 && __builtin_cpu_supports("sse2")) active_kernels = &kernels_sse2;
+#endif
+}
+
+const NNKernels* nn_kernels(void) {
+    pthread_once(&select_once, select_kernels);
+    return active_kernels;
+}
@@ -0,0 +1,44 @@
+#ifndef NN_SIMD_H
+#define NN_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Dense kernels behind the engine's forward/backward passes.
+// One implementation per instruction set (AVX-512, AVX2+FMA, SSE2, scalar),
+// picked once at runtime from CPUID. Set CORTEX_SIMD=scalar|sse2|avx2|avx512
+// to force a lower level (e.g. for benchmarking).
+//
+// dot, dot4 and gemm4x4 reduce each output in the same order, so a neuron's
+// value does not depend on which of them computed it.
+typedef struct {
+    const char* name;
+
+    // sum(a[i] * b[i])
+    double (*dot)(const double* a, const double* b, int n);
+    // out[r] = dot(x, w + r * ldw) for 4 consecutive weight rows
+    void (*dot4)(const double* x, const double* w, int ldw, int n, double out[4]);
+    // out[s][r] = dot(x + s * ldx, w + r * ldw) for a 4-sample x 4-row tile
+    void (*gemm4x4)(const double* x, int ldx, const double* w, int ldw, int n, double out[4][4]);
+
+    // y += alpha * x
+    void (*axpy)(double* y, double alpha, const double* x, size_t n);
+    // d *= act * (1 - act), the sigmoid derivative step of backprop
+    void (*mul_deriv)(double* d, const double* act, int n);
+
+    // Float weights (NN_FLOAT32 / NN_MIXED): sum(a[i] * b[i]) accumulated in
+    // float, or in double from exact float products
+    float (*dot_f32)(const float* a, const float* b, int n);
+    double (*dot_f32_acc64)(const float* a, const float* b, int n);
+
+    // Quantized inference: sum(x[i] * w[i]) in int32, with x in 0..127
+    int32_t (*dot_u8s8)(const uint8_t* x, const int8_t* w, int n);
+
+    // x[i] = 1 / (1 + exp(-x[i])) with exp from a range-reduced polynomial:
+    // c[0..degree] approximate 2^f on [-0.5, 0.5]
+    void (*sigmoid_poly)(double* x, int n, const double* c, int degree);
+} NNKernels;
+
+const NNKernels* nn_kernels(void);
+
+#endif
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nn.h"
+#include "nn_stats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static const char* OP_NAMES[NN_OP_COUNT] = {
+    "predict", "predict_batch", "train", "train_batch", "gradients", "save", "load"
+};
+static const char* PHASE_NAMES[NN_PHASE_COUNT] = { "forward", "backward", "update", "io" };
+
+// --- Histograms ---
+
+int nn_stats_bucket(uint64_t ns) {
+    int b = 0;
+    while (b < NN_STATS_BUCKETS - 1 && (ns >> (b + 1)) != 0) b++;
+    return b;
+}
+
+double nn_stats_quantile(const long long* buckets, long long count, double q) {
+    long long seen = 0;
+    for(int b = 0; b < NN_STATS_BUCKETS; b++) {
+        seen += buckets[b];
+        if (count && seen >= q * count) return (double)(2ull << b);
+    }
+    return 0.0;
+}
+
+#ifndef NN_NO_STATS
+#include <stdatomic.h>
+
+typedef struct {
+    atomic_llong calls;
+    atomic_llong samples;
+    atomic_llong flops;
+    atomic_llong ns;
+    atomic_llong buckets[NN_STATS_BUCKETS];
+} OpCounters;
+
+atomic_int nn_stats_switch;
+static OpCounters op_counters[NN_OP_COUNT];
+static atomic_llong phase_counters[NN_PHASE_COUNT];
+static atomic_llong allocations, frees, allocated_bytes;
+
+static void add(atomic_llong* counter, long long value) {
+    atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+}
+
+static long long get(atomic_llong* counter) {
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+// --- Hooks ---
+
+uint64_t nn_stats_now(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t nn_stats_record_phase(NNStatPhase phase, uint64_t start) {
+    uint64_t end = nn_stats_now();
+    add(&phase_counters[phase], (long long)(end - start));
+    return end;
+}
+
+void nn_stats_record_op(NNStatOp op, uint64_t start, uint64_t end, long long samples, long long flops) {
+    OpCounters* c = &op_counters[op];
+    uint64_t ns = end - start;
+    add(&c->calls, 1);
+    add(&c->samples, samples);
+    add(&c->flops, flops);
+    add(&c->ns, (long long)ns);
+    add(&c->buckets[nn_stats_bucket(ns)], 1);
+}
+
+void nn_stats_record_alloc(size_t bytes) {
+    add(&allocations, 1);
+    add(&allocated_bytes, (long long)bytes);
+}
+
+void nn_stats_record_free(void) {
+    add(&frees, 1);
+}
+
+// --- Control ---
+
+void nn_stats_enable(int on) {
+    atomic_store_explicit(&nn_stats_switch, on != 0, memory_order_relaxed);
+}
+
+int nn_stats_enabled(void) {
+    return atomic_load_explicit(&nn_stats_switch, memory_order_relaxed);
+}
+
+void nn_stats_reset(void) {
+    for(int op = 0; op < NN_OP_COUNT; op++) {
+        OpCounters* c = &op_counters[op];
+        atomic_store(&c->calls, 0);
+        atomic_store(&c->samples, 0);
+        atomic_store(&c->flops, 0);
+        atomic_store(&c->ns, 0);
+        for(int b = 0; b < NN_STATS_BUCKETS; b++) atomic_store(&c->buckets[b], 0);
+    }
+    for(int p = 0; p < NN_PHASE_COUNT; p++) atomic_store(&phase_counters[p], 0);
+    atomic_store(&allocations, 0);
+    atomic_store(&frees, 0);
+    atomic_store(&allocated_bytes, 0);
+}
+
+// Counters are read one by one: a snapshot taken while the engine runs may
+// mix values from slightly different moments
+void nn_stats_snapshot(NNStats* stats) {
+    for(int op = 0; op < NN_OP_COUNT; op++) {
+        OpCounters* c = &op_counters[op];
+        NNOpStats* s = &stats->ops[op];
+        s->calls = get(&c->calls);
+        s->samples = get(&c->samples);
+        s->flops = get(&c->flops);
+        s->ns = get(&c->ns);
+        for(int b = 0; b < NN_STATS_BUCKETS; b++) s->buckets[b] = get(&c->buckets[b]);
+    }
+    for(int p = 0; p < NN_PHASE_COUNT; p++) stats->phase_ns[p] = get(&phase_counters[p]);
+    stats->allocations = get(&allocations);
+    stats->frees = get(&frees);
+    stats->allocated_bytes = get(&allocated_bytes);
+}
+
+#else
+
+void nn_stats_enable(int on) { (void)on; }
+int nn_stats_enabled(void) { return 0; }
+void nn_stats_reset(void) {}
+void nn_stats_snapshot(NNStats* stats) { memset(stats, 0, sizeof(NNStats)); }
+
+#endif
+
+// --- Export ---
+
+const char* nn_stats_op_name(NNStatOp op) { return OP_NAMES[op]; }
+const char* nn_stats_phase_name(NNStatPhase phase) { return PHASE_NAMES[phase]; }
+
+// Upper bound (ns) of the bucket holding the q-quantile call, 0 without calls
+static double quantile_ns(const NNOpStats* s, double q) {
+    return nn_stats_quantile(s->buckets, s->calls, q);
+}
+
+static void write_text(FILE* f, const NNStats* st) {
+    fprintf(f, "%-14s %12s %14s %12s %10s %10s %10s\n", "operation", "calls", "samples", "GFLOP", "mean us", "p50 us<", "p99 us<");
+    for(int op = 0; op < NN_OP_COUNT; op++) {
+        const NNOpStats* s = &st->ops[op];
+        fprintf(f, "%-14s %12lld %14lld %12.3f %10.2f %10.2f %10.2f\n", OP_NAMES[op], s->calls, s->samples,
+                s->flops / 1e9, s->calls ? s->ns / 1e3 / s->calls : 0.0, quantile_ns(s, 0.5) / 1e3, quantile_ns(s, 0.99) / 1e3);
+    }
+    fprintf(f, "\n%-14s %12s\n", "phase", "seconds");
+    for(int p = 0; p < NN_PHASE_COUNT; p++) fprintf(f, "%-14s %12.6f\n", PHASE_NAMES[p], st->phase_ns[p] / 1e9);
+    fprintf(f, "\nallocations %lld (%lld bytes), frees %lld\n", st->allocations, st->allocated_bytes, st->frees);
+}
+
+static void write_json(FILE* f, const NNStats* st) {
+    fprintf(f, "{\n  \"ops\": {");
+    for(int op = 0; op < NN_OP_COUNT; op++) {
+        const NNOpStats* s = &st->ops[op];
+        fprintf(f, "%s\n    \"%s\": {\"calls\": %lld, \"samples\": %lld, \"flops\": %lld, \"ns\": %lld, \"buckets_log2_ns\": [",
+                op ? "," : "", OP_NAMES[op], s->calls, s->samples, s->flops, s->ns);
+        for(int b = 0; b < NN_STATS_BUCKETS; b++) fprintf(f, "%s%lld", b ? ", " : "", s->buckets[b]);
+        fprintf(f, "]}");
+    }
+    fprintf(f, "\n  },\n  \"phases_ns\": {");
+    for(int p = 0; p < NN_PHASE_COUNT; p++) fprintf(f, "%s\"%s\": %lld", p ? ", " : "", PHASE_NAMES[p], st->phase_ns[p]);
+    fprintf(f, "},\n  \"allocations\": %lld,\n  \"frees\": %lld,\n  \"allocated_bytes\": %lld\n}\n",
+            st->allocations, st->frees, st->allocated_bytes);
+}
+
+static void prometheus_counter(FILE* f, const char* name, const char* help, const NNStats* st, size_t field) {
+    fprintf(f, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    for(int op = 0; op < NN_OP_COUNT; op++) {
+        long long value = *(const long long*)((const char*)&st->ops[op] + field);
+        fprintf(f, "%s{op=\"%s\"} %lld\n", name, OP_NAMES[op], value);
+    }
+}
+
+static void write_prometheus(FILE* f, const NNStats* st) {
+    prometheus_counter(f, "cortex_nn_calls_total", "Engine calls by operation.", st, offsetof(NNOpStats, calls));
+    prometheus_counter(f, "cortex_nn_samples_total", "Samples processed by operation.", st, offsetof(NNOpStats, samples));
+    prometheus_counter(f, "cortex_nn_flops_total", "Floating-point operations in the dense layers.", st, offsetof(NNOpStats, flops));
+
+    fprintf(f, "# HELP cortex_nn_call_duration_seconds Latency of engine calls.\n");
+    fprintf(f, "# TYPE cortex_nn_call_duration_seconds histogram\n");
+    for(int op = 0; op < NN_OP_COUNT; op++) {
+        const NNOpStats* s = &st->ops[op];
+        long long seen = 0;
+        for(int b = 0; b < NN_STATS_BUCKETS - 1; b++) {
+            seen += s->buckets[b];
+            fprintf(f, "cortex_nn_call_duration_seconds_bucket{op=\"%s\",le=\"%.9g\"} %lld\n", OP_NAMES[op], (2ull << b) / 1e9, seen);
+        }
+        fprintf(f, "cortex_nn_call_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %lld\n", OP_NAMES[op], s->calls);
+        fprintf(f, "cortex_nn_call_duration_seconds_sum{op=\"%s\"} %.9f\n", OP_NAMES[op], s->ns / 1e9);
+        fprintf(f, "cortex_nn_call_duration_seconds_count{op=\"%s\"} %lld\n", OP_NAMES[op], s->calls);
+    }
+
+    fprintf(f, "# HELP cortex_nn_phase_seconds_total Time spent per engine phase.\n# TYPE cortex_nn_phase_seconds_total counter\n");
+    for(int p = 0; p < NN_PHASE_COUNT; p++) {
+        fprintf(f, "cortex_nn_phase_seconds_total{phase=\"%s\"} %.9f\n", PHASE_NAMES[p], st->phase_ns[p] / 1e9);
+    }
+    fprintf(f, "# HELP cortex_nn_allocations_total Aligned allocations made by the engine.\n# TYPE cortex_nn_allocations_total counter\n");
+    fprintf(f, "cortex_nn_allocations_total %lld\n", st->allocations);
+    fprintf(f, "# HELP cortex_nn_frees_total Aligned allocations released.\n# TYPE cortex_nn_frees_total counter\n");
+    fprintf(f, "cortex_nn_frees_total %lld\n", st->frees);
+    fprintf(f, "# HELP cortex_nn_allocated_bytes_total Bytes allocated by the engine.\n# TYPE cortex_nn_allocated_bytes_total counter\n");
+    fprintf(f, "cortex_nn_allocated_bytes_total %lld\n", st->allocated_bytes);
+}
+
+int nn_stats_write(FILE* file, NNStatsFormat format) {
+    NNStats stats;
+    nn_stats_snapshot(&stats);
+    if (format == NN_STATS_JSON) write_json(file, &stats);
+    else if (format == NN_STATS_PROMETHEUS) write_prometheus(file, &stats);
+    else write_text(file, &stats);
+    return !ferror(file);
+}
+
+static int has_suffix(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+int nn_stats_export(const char* filename) {
+    NNStatsFormat format = has_suffix(filename, ".json") ? NN_STATS_JSON
+                         : has_suffix(filename, ".prom") ? NN_STATS_PROMETHEUS : NN_STATS_TEXT;
+    char* temp = malloc(strlen(filename) + 5);
+    if (!temp) return 0;
+    sprintf(temp, "%s.tmp", filename);
+
+    FILE* file = fopen(temp, "w");
+    int ok = file && nn_stats_write(file, format);
+    if (file && fclose(file) != 0) ok = 0;
+    if (ok) ok = nn_replace_file(temp, filename);
+    if (!ok) remove(temp);
+    free(temp);
+    return ok;
+}
@@ -0,0 +1,111 @@
+#ifndef NN_STATS_H
+#define NN_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Engine instrumentation: calls, samples, FLOPs and a latency histogram per
+// public operation, time per phase, and the engine's allocations. Off until
+// nn_stats_enable(1); while off each hook costs one relaxed atomic load.
+// Counters are process-wide atomics, so trainer threads can record freely.
+// Build with -DNN_NO_STATS to compile the hooks out (snapshots stay zero).
+#define NN_STATS_BUCKETS 32  // Bucket b counts calls of [2^b, 2^(b+1)) ns; the last one is open
+
+typedef enum {
+    NN_OP_PREDICT,        // predict_into (and predict)
+    NN_OP_PREDICT_BATCH,  // predict_batch_with_workspace (and predict_batch)
+    NN_OP_TRAIN,          // train_with_workspace (and train)
+    NN_OP_TRAIN_BATCH,    // train_batch and trainer_step
+    NN_OP_GRADIENTS,      // accumulate_gradients, inside the two above too
+    NN_OP_SAVE,
+    NN_OP_LOAD,
+    NN_OP_COUNT
+} NNStatOp;
+
+typedef enum {
+    NN_PHASE_FORWARD,
+    NN_PHASE_BACKWARD,  // Deltas and gradient accumulation
+    NN_PHASE_UPDATE,    // Weight updates
+    NN_PHASE_IO,        // Model files
+    NN_PHASE_COUNT
+} NNStatPhase;
+
+typedef struct {
+    long long calls;
+    long long samples;
+    long long flops;  // 2 per multiply-add in the dense layers
+    long long ns;
+    long long buckets[NN_STATS_BUCKETS];
+} NNOpStats;
+
+typedef struct {
+    NNOpStats ops[NN_OP_COUNT];
+    long long phase_ns[NN_PHASE_COUNT];
+    long long allocations;  // nn_aligned_alloc calls (slabs, workspaces)
+    long long frees;
+    long long allocated_bytes;
+} NNStats;
+
+typedef enum { NN_STATS_TEXT, NN_STATS_JSON, NN_STATS_PROMETHEUS } NNStatsFormat;
+
+// --- Control ---
+void nn_stats_enable(int on);
+int nn_stats_enabled(void);
+void nn_stats_reset(void);
+
+// --- Histograms ---
+// Log2 latency histograms of NN_STATS_BUCKETS buckets, shared with the server
+int nn_stats_bucket(uint64_t ns);
+// Upper bound (ns) of the bucket holding the q-quantile of 'count' entries, 0 when empty
+double nn_stats_quantile(const long long* buckets, long long count, double q);
+
+// --- Export ---
+void nn_stats_snapshot(NNStats* stats);
+const char* nn_stats_op_name(NNStatOp op);
+const char* nn_stats_phase_name(NNStatPhase phase);
+int nn_stats_write(FILE* file, NNStatsFormat format);  // 0 on failure
+// Replaces 'filename' atomically (temporary file + nn_replace_file), e.g. for a
+// Prometheus textfile collector; the format follows the extension:
+// .json, .prom, anything else text
+int nn_stats_export(const char* filename);
+
+// --- Hooks (engine internals) ---
+// nn_stats_begin() returns a timestamp, 0 while disabled; the others do
+// nothing for a 0 start. nn_stats_phase() returns the end time so phases
+// and the enclosing operation can share clock reads.
+#ifdef NN_NO_STATS
+static inline uint64_t nn_stats_begin(void) { return 0; }
+static inline uint64_t nn_stats_phase(NNStatPhase phase, uint64_t start) { (void)phase; (void)start; return 0; }
+static inline void nn_stats_op(NNStatOp op, uint64_t start, uint64_t end, long long samples, long long flops) {
+    (void)op; (void)start; (void)end; (void)samples; (void)flops;
+}
+static inline void nn_stats_alloc(size_t bytes) { (void)bytes; }
+static inline void nn_stats_free(void) {}
+#else
+#include <stdatomic.h>
+extern atomic_int nn_stats_switch;
+uint64_t nn_stats_now(void);
+uint64_t nn_stats_record_phase(NNStatPhase phase, uint64_t start);
+void nn_stats_record_op(NNStatOp op, uint64_t start, uint64_t end, long long samples, long long flops);
+void nn_stats_record_alloc(size_t bytes);
+void nn_stats_record_free(void);
+
+static inline uint64_t nn_stats_begin(void) {
+    return atomic_load_explicit(&nn_stats_switch, memory_order_relaxed) ? nn_stats_now() : 0;
+}
+static inline uint64_t nn_stats_phase(NNStatPhase phase, uint64_t start) {
+    return start ? nn_stats_record_phase(phase, start) : 0;
+}
+static inline void nn_stats_op(NNStatOp op, uint64_t start, uint64_t end, long long samples, long long flops) {
+    if (start) nn_stats_record_op(op, start, end ? end : nn_stats_now(), samples, flops);
+}
+static inline void nn_stats_alloc(size_t bytes) {
+    if (atomic_load_explicit(&nn_stats_switch, memory_order_relaxed)) nn_stats_record_alloc(bytes);
+}
+static inline void nn_stats_free(void) {
+    if (atomic_load_explicit(&nn_stats_switch, memory_order_relaxed)) nn_stats_record_free();
+}
+#endif
+
+#endif
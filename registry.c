@@ -0,0 +1,353 @@
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "registry.h"
+
+typedef struct RegistryEntry {
+    char* name;
+    NeuralNetwork* nn;
+    size_t bytes;
+    int refs;
+    unsigned long long last_used;  // Registry clock at the last acquire
+    struct RegistryEntry* next;
+} RegistryEntry;
+
+struct NNRegistry {
+    pthread_mutex_t lock;
+    RegistryEntry* entries;  // Cached brains
+    RegistryEntry* retired;  // Evicted or replaced while still referenced
+    unsigned long long clock;
+    NNRegistryStats stats;
+};
+
+// --- Entries ---
+
+static RegistryEntry* find_entry(RegistryEntry* list, const char* name) {
+    for(RegistryEntry* e = list; e; e = e->next) {
+        if (strcmp(e->name, name) == 0) return e;
+    }
+    return NULL;
+}
+
+static RegistryEntry* new_entry(const char* name, NeuralNetwork* nn) {
+    RegistryEntry* e = calloc(1, sizeof(RegistryEntry));
+    if (!e) return NULL;
+    e->name = malloc(strlen(name) + 1);
+    if (!e->name) {
+        free(e);
+        return NULL;
+    }
+    strcpy(e->name, name);
+    e->nn = nn;
+    e->bytes = network_memory(nn);
+    return e;
+}
+
+static void free_entry(RegistryEntry* e) {
+    free_network(e->nn);
+    free(e->name);
+    free(e);
+}
+
+// Unlinks 'e' from the cache: freed now if unused, otherwise on last release
+static void retire_entry(NNRegistry* reg, RegistryEntry* e) {
+    RegistryEntry** link = &reg->entries;
+    while (*link != e) link = &(*link)->next;
+    *link = e->next;
+    reg->stats.models--;
+    reg->stats.bytes -= e->bytes;
+
+    if (e->refs == 0) {
+        free_entry(e);
+    } else {
+        e->next = reg->retired;
+        reg->retired = e;
+    }
+}
+
+static void insert_entry(NNRegistry* reg, RegistryEntry* e) {
+    e->refs = 1;
+    e->last_used = ++reg->clock;
+    e->next = reg->entries;
+    reg->entries = e;
+    reg->stats.models++;
+    reg->stats.bytes += e->bytes;
+}
+
+// Evict idle brains, least recently used first, until within budget
+static void trim(NNRegistry* reg) {
+    while (reg->stats.budget && reg->stats.bytes > reg->stats.budget) {
+        RegistryEntry* victim = NULL;
+        for(RegistryEntry* e = reg->entries; e; e = e->next) {
+            if (e->refs == 0 && (!victim || e->last_used < victim->last_used)) victim = e;
+        }
+        if (!victim) return;  // Everything left is in use
+        retire_entry(reg, victim);
+        reg->stats.evictions++;
+    }
+}
+
+static int file_readable(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+    fclose(file);
+    return 1;
+}
+
+// --- Lifecycle ---
+
+NNRegistry* create_registry(size_t budget_bytes) {
+    NNRegistry* reg = calloc(1, sizeof(NNRegistry));
+    if (!reg) return NULL;
+    pthread_mutex_init(&reg->lock, NULL);
+    reg->stats.budget = budget_bytes;
+    return reg;
+}
+
+void free_registry(NNRegistry* reg) {
+    if (!reg) return;
+    for(RegistryEntry* list = reg->entries; list; ) {
+        RegistryEntry* next = list->next;
+        free_entry(list);
+        list = next;
+    }
+    for(RegistryEntry* list = reg->retired; list; ) {
+        RegistryEntry* next = list->next;
+        free_entry(list);
+        list = next;
+    }
+    pthread_mutex_destroy(&reg->lock);
+    free(reg);
+}
+
+// --- Operations ---
+
+const NeuralNetwork* registry_acquire(NNRegistry* reg, const char* name) {
+    pthread_mutex_lock(&reg->lock);
+    RegistryEntry* e = find_entry(reg->entries, name);
+    if (e) {
+        e->refs++;
+        e->last_used = ++reg->clock;
+        reg->stats.hits++;
+        pthread_mutex_unlock(&reg->lock);
+        return e->nn;
+    }
+
+    // First use: load under the lock so concurrent callers share one load
+    NeuralNetwork* nn = file_readable(name) ? load_network(name) : NULL;
+    e = nn ? new_entry(name, nn) : NULL;
+    if (!e) {
+        free_network(nn);
+        pthread_mutex_unlock(&reg->lock);
+        return NULL;
+    }
+    insert_entry(reg, e);
+    reg->stats.loads++;
+    trim(reg);
+    pthread_mutex_unlock(&reg->lock);
+    return nn;
+}
+
+void registry_release(NNRegistry* reg, const NeuralNetwork* nn) {
+    if (!nn) return;
+    pthread_mutex_lock(&reg->lock);
+    for(RegistryEntry* e = reg->entries; e; e = e->next) {
+        if (e->nn == nn) {
+            e->refs--;
+            trim(reg);
+            pthread_mutex_unlock(&reg->lock);
+            return;
+        }
+    }
+    for(RegistryEntry** link = &reg->retired; *link; link = &(*link)->next) {
+        RegistryEntry* e = *link;
+        if (e->nn == nn) {
+            if (--e->refs == 0) {
+                *link = e->next;
+                free_entry(e);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&reg->lock);
+}
+
+const NeuralNetwork* registry_publish(NNRegistry* reg, const char* name, NeuralNetwork* nn) {
+    if (!nn) return NULL;
+    RegistryEntry* e = new_entry(name, nn);
+    if (!e) {
+        free_network(nn);
+        return NULL;
+    }
+    pthread_mutex_lock(&reg->lock);
+    RegistryEntry* old = find_entry(reg->entries, name);
+    if (old) retire_entry(reg, old);
+    insert_entry(reg, e);
+    trim(reg);
+    pthread_mutex_unlock(&reg->lock);
+    return nn;
+}
+
+const NeuralNetwork* registry_reload(NNRegistry* reg, const char* name) {
+    NeuralNetwork* nn = file_readable(name) ? load_network(name) : NULL;
+    if (!nn) return NULL;
+    pthread_mutex_lock(&reg->lock);
+    reg->stats.loads++;
+    pthread_mutex_unlock(&reg->lock);
+    return registry_publish(reg, name, nn);
+}
+
+void registry_evict(NNRegistry* reg, const char* name) {
+    pthread_mutex_lock(&reg->lock);
+    RegistryEntry* e = find_entry(reg->entries, name);
+    if (e) {
+        retire_entry(reg, e);
+        reg->stats.evictions++;
+    }
+    pthread_mutex_unlock(&reg->lock);
+}
+
+void registry_set_budget(NNRegistry* reg, size_t budget_bytes) {
+    pthread_mutex_lock(&reg->lock);
+    reg->stats.budget = budget_bytes;
+    trim(reg);
+    pthread_mutex_unlock(&reg->lock);
+}
+
+NNRegistryStats registry_stats(NNRegistry* reg) {
+    pthread_mutex_lock(&reg->lock);
+    NNRegistryStats stats = reg->stats;
+    pthread_mutex_unlock(&reg->lock);
+    return stats;
+}
+
+// --- Hot Swap ---
+
+struct NNSlotReader {
+    _Atomic(const NeuralNetwork*) hazard;  // Pinned brain, NULL when none
+    NNModelSlot* slot;
+    NNSlotReader* next;
+};
+
+typedef struct RetiredBrain {
+    const NeuralNetwork* nn;
+    struct RetiredBrain* next;
+} RetiredBrain;
+
+struct NNModelSlot {
+    NNRegistry* reg;
+    _Atomic(const NeuralNetwork*) current;
+    int inputs;
+    int outputs;
+    pthread_mutex_t lock;    // Writers: swaps, reclamation, new readers
+    NNSlotReader* readers;
+    RetiredBrain* retired;   // Swapped out, possibly still pinned
+};
+
+static int pinned(const NNModelSlot* slot, const NeuralNetwork* nn) {
+    for(NNSlotReader* r = slot->readers; r; r = r->next) {
+        if (atomic_load(&r->hazard) == nn) return 1;
+    }
+    return 0;
+}
+
+// Under the slot's lock
+static int reclaim(NNModelSlot* slot) {
+    int left = 0;
+    RetiredBrain** link = &slot->retired;
+    while (*link) {
+        RetiredBrain* old = *link;
+        if (pinned(slot, old->nn)) {
+            left++;
+            link = &old->next;
+        } else {
+            *link = old->next;
+            registry_release(slot->reg, old->nn);
+            free(old);
+        }
+    }
+    return left;
+}
+
+NNModelSlot* create_model_slot(NNRegistry* reg, const NeuralNetwork* nn) {
+    NNModelSlot* slot = nn ? calloc(1, sizeof(NNModelSlot)) : NULL;
+    if (!slot) {
+        registry_release(reg, nn);
+        return NULL;
+    }
+    slot->reg = reg;
+    atomic_init(&slot->current, nn);
+    slot->inputs = nn->input_nodes;
+    slot->outputs = nn->output_nodes;
+    pthread_mutex_init(&slot->lock, NULL);
+    return slot;
+}
+
+void free_model_slot(NNModelSlot* slot) {
+    if (!slot) return;
+    reclaim(slot);
+    registry_release(slot->reg, atomic_load(&slot->current));
+    while (slot->readers) {
+        NNSlotReader* next = slot->readers->next;
+        free(slot->readers);
+        slot->readers = next;
+    }
+    pthread_mutex_destroy(&slot->lock);
+    free(slot);
+}
+
+NNSlotReader* slot_reader(NNModelSlot* slot) {
+    NNSlotReader* reader = calloc(1, sizeof(NNSlotReader));
+    if (!reader) return NULL;
+    atomic_init(&reader->hazard, NULL);
+    reader->slot = slot;
+    pthread_mutex_lock(&slot->lock);
+    reader->next = slot->readers;
+    slot->readers = reader;
+    pthread_mutex_unlock(&slot->lock);
+    return reader;
+}
+
+// Announce, then check the brain is still current: a swap that ran in
+// between may not have seen the announcement, so try again with the new one.
+// Both sides use sequentially consistent operations, so a swap that misses
+// the hazard is one the re-check sees.
+const NeuralNetwork* slot_pin(NNSlotReader* reader) {
+    const NeuralNetwork* nn = atomic_load(&reader->slot->current);
+    while (1) {
+        atomic_store(&reader->hazard, nn);
+        const NeuralNetwork* now = atomic_load(&reader->slot->current);
+        if (now == nn) return nn;
+        nn = now;
+    }
+}
+
+void slot_unpin(NNSlotReader* reader) {
+    atomic_store_explicit(&reader->hazard, NULL, memory_order_release);
+}
+
+int slot_swap(NNModelSlot* slot, const NeuralNetwork* nn) {
+    RetiredBrain* old = nn ? malloc(sizeof(RetiredBrain)) : NULL;
+    if (!old || nn->input_nodes != slot->inputs || nn->output_nodes != slot->outputs) {
+        free(old);
+        registry_release(slot->reg, nn);
+        return 0;
+    }
+    pthread_mutex_lock(&slot->lock);
+    old->nn = atomic_exchange(&slot->current, nn);
+    old->next = slot->retired;
+    slot->retired = old;
+    reclaim(slot);
+    pthread_mutex_unlock(&slot->lock);
+    return 1;
+}
+
+int slot_reclaim(NNModelSlot* slot) {
+    pthread_mutex_lock(&slot->lock);
+    int left = reclaim(slot);
+    pthread_mutex_unlock(&slot->lock);
+    return left;
+}
+
+int slot_inputs(const NNModelSlot* slot) { return slot->inputs; }
+int slot_outputs(const NNModelSlot* slot) { return slot->outputs; }
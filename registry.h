@@ -0,0 +1,73 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include "nn.h"
+
+// In-process model cache keyed by brain name (the model file name).
+// Each brain is loaded from disk once, on first use, and handed out as a
+// shared read-only reference; later acquisitions never touch the disk.
+// Unreferenced brains are evicted least-recently-used first when the total
+// weight memory exceeds the budget. Thread-safe.
+typedef struct NNRegistry NNRegistry;
+
+typedef struct {
+    int models;          // Brains currently cached
+    size_t bytes;        // Their weight memory (see network_memory)
+    size_t budget;       // 0: unlimited
+    long long hits;      // Acquisitions served from memory
+    long long loads;     // Acquisitions that read the file
+    long long evictions;
+} NNRegistryStats;
+
+// --- Lifecycle ---
+NNRegistry* create_registry(size_t budget_bytes);  // 0: no memory limit
+void free_registry(NNRegistry* reg);  // Frees every cached brain; all references must be released
+
+// --- Operations ---
+// Shared reference to a brain, loading it on first use. NULL if the file is
+// missing or invalid. Every successful call is paired with registry_release().
+const NeuralNetwork* registry_acquire(NNRegistry* reg, const char* name);
+void registry_release(NNRegistry* reg, const NeuralNetwork* nn);
+
+// Hands a freshly built brain to the registry (which then owns it) and
+// returns an acquired reference. A cached brain of the same name is replaced;
+// its current holders keep using it until they release it.
+const NeuralNetwork* registry_publish(NNRegistry* reg, const char* name, NeuralNetwork* nn);
+
+// Reads the brain's file again and publishes it like registry_publish. NULL,
+// with the cache unchanged, if the file is missing or invalid.
+const NeuralNetwork* registry_reload(NNRegistry* reg, const char* name);
+
+// Drops a brain from the cache (freed once its last reference is released)
+void registry_evict(NNRegistry* reg, const char* name);
+void registry_set_budget(NNRegistry* reg, size_t budget_bytes);  // Evicts down to the new budget
+NNRegistryStats registry_stats(NNRegistry* reg);
+
+// --- Hot Swap ---
+// A slot serves one brain to threads that must never wait on a lock. Each
+// reading thread pins the current brain through its own NNSlotReader (a
+// hazard pointer); a pinned brain stays valid until unpinned, even if it is
+// swapped out meanwhile. slot_swap() installs a new brain at once and hands
+// the old one back to the registry when no reader has it pinned, checked at
+// each swap and by slot_reclaim(). Writers serialize on the slot; readers
+// never take a lock.
+typedef struct NNModelSlot NNModelSlot;
+typedef struct NNSlotReader NNSlotReader;
+
+// Takes over an acquired reference; later brains must keep its input and
+// output counts
+NNModelSlot* create_model_slot(NNRegistry* reg, const NeuralNetwork* nn);
+void free_model_slot(NNModelSlot* slot);  // Releases its brains; no reader may be left pinned
+NNSlotReader* slot_reader(NNModelSlot* slot);  // One per reading thread, freed with the slot
+
+const NeuralNetwork* slot_pin(NNSlotReader* reader);
+void slot_unpin(NNSlotReader* reader);
+
+// Takes over an acquired reference and publishes it. 0 (and 'nn' released)
+// when its input or output count differs from the slot's.
+int slot_swap(NNModelSlot* slot, const NeuralNetwork* nn);
+int slot_reclaim(NNModelSlot* slot);  // Returns the retired brains still pinned
+int slot_inputs(const NNModelSlot* slot);
+int slot_outputs(const NNModelSlot* slot);
+
+#endif
@@ -7,7 +7,7 @@ taskkill /IM Cortex.exe /F >nul 2>&1
 echo Compiling Cortex OS...
 
 :: Compile source files
-gcc main.c nn.c -o Cortex
+gcc -O2 main.c nn.c nn_simd.c nn_stats.c registry.c spam.c mailbox.c server.c learner.c -o Cortex -pthread
 if %errorlevel% neq 0 (
     echo [ERROR] Compilation failed.
     exit /b %errorlevel%
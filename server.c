@@ -0,0 +1,1103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "server.h"
+
+static const char* STAGE_NAMES[SERVER_STAGE_COUNT] = { "queue", "extract", "batch", "score", "total" };
+
+const char* server_stage_name(ServerStage stage) { return STAGE_NAMES[stage]; }
+
+double server_latency_quantile(const ServerLatency* latency, double q) {
+    return nn_stats_quantile(latency->buckets, latency->count, q);
+}
+
+#ifdef _WIN32
+
+int run_server(const char* path, const ServerModel* models, int count, const ServerOptions* options,
+               ServerStats* stats) {
+    (void)path; (void)models; (void)count; (void)options;
+    memset(stats, 0, sizeof(ServerStats));
+    fprintf(stderr, "Error: server mode needs Unix domain sockets, not available on Windows.\n");
+    return 0;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#define SERVER_MAX_CONNECTIONS 16384
+#define SERVER_MAX_BATCH 4096
+#define SERVER_BACKLOG (SERVER_PIPELINE * SERVER_REPLY)  // Unsent reply bytes before a connection is not read
+#define SERVER_EXTRACT_CHUNK 32   // Most requests a worker takes from the extract queue at once
+#define SERVER_INLINE_TEXT 128    // Request text that needs no allocation
+#define SERVER_BUFFER 4096        // First receive or send buffer of a connection
+#define SERVER_POOL_CHUNK 64      // Requests allocated at a time
+#define SERVER_EVENTS 256
+#define SERVER_TICK_MS 100        // How often the event loop checks for a signal
+
+typedef struct Server Server;
+typedef struct Connection Connection;
+
+// A descriptor in the poller
+typedef struct {
+    int fd;
+    int slot;  // Index in the poll() arrays
+} Watch;
+
+typedef struct Request {
+    struct Request* next;   // Extract queue, score queue, done list or spares
+    struct Request* after;  // Next request of the same connection
+    Connection* conn;
+    unsigned long long seq;
+    int model;              // -1: answered with 'error'
+    int done;               // Reply ready, as seen by the event loop
+    int learn;              // Feedback: 'target' is the label, nothing is scored
+    double target;
+    uint64_t read_at, extract_at, extracted_at;
+    char* text;             // inline_text or allocated
+    size_t length;
+    double* inputs;
+    double raw[SERVER_RAW];
+    char reply[SERVER_REPLY];
+    size_t reply_length;
+    char inline_text[SERVER_INLINE_TEXT];
+} Request;
+
+struct Connection {
+    Watch watch;              // First: the poller hands back Watch pointers
+    Connection* next;         // Open connections
+    Connection* prev;
+    Connection* paused_next;  // Held back by the server's limits
+    Connection* touched_next; // Got replies this round
+    int paused;
+    int touched;
+    int registered;           // In the poller
+    unsigned events;          // Registered interest
+
+    char* in;                 // Received bytes: in[0..in_length), freed when empty
+    size_t in_length, in_capacity;
+    int discarding;           // Skipping the rest of an overlong line
+    int eof;                  // No more requests: hung up, or shutting down
+    int broken;               // Cannot send: replies are dropped
+
+    Request* head;            // In flight, in arrival order
+    Request* tail;
+    int inflight;
+
+    char* out;                // Unsent replies: out[out_start..out_length), freed when sent
+    size_t out_start, out_length, out_capacity;
+};
+
+typedef struct {
+    pthread_t thread;
+    Server* server;
+    NNSlotReader* readers[SERVER_MAX_MODELS];
+    NNWorkspace* ws[SERVER_MAX_MODELS];  // Rebuilt when a swapped-in brain changes shape
+    Request** batch;
+    double* inputs;
+    double* outputs;
+    NNArena* arena;
+} Worker;
+
+// --- Poller ---
+
+#define WATCH_IN 1u
+#define WATCH_OUT 2u
+#define WATCH_HUP 4u  // Hung up or failed
+
+typedef struct {
+    Watch* watch;
+    unsigned events;
+} PollEvent;
+
+#ifdef __linux__
+
+typedef struct {
+    int fd;
+    struct epoll_event events[SERVER_EVENTS];
+} Poller;
+
+static int poller_open(Poller* p) {
+    p->fd = epoll_create1(0);
+    return p->fd >= 0;
+}
+
+static void poller_close(Poller* p) { close(p->fd); }
+
+static int poller_ctl(Poller* p, int op, Watch* w, unsigned events) {
+    struct epoll_event e;
+    memset(&e, 0, sizeof(e));
+    e.events = ((events & WATCH_IN) ? EPOLLIN : 0) | ((events & WATCH_OUT) ? EPOLLOUT : 0);
+    e.data.ptr = w;
+    return epoll_ctl(p->fd, op, w->fd, &e) == 0;
+}
+
+static int poller_add(Poller* p, Watch* w, unsigned events) { return poller_ctl(p, EPOLL_CTL_ADD, w, events); }
+static void poller_modify(Poller* p, Watch* w, unsigned events) { poller_ctl(p, EPOLL_CTL_MOD, w, events); }
+static void poller_remove(Poller* p, Watch* w) { poller_ctl(p, EPOLL_CTL_DEL, w, 0); }
+
+static int poller_wait(Poller* p, PollEvent* out, int timeout_ms) {
+    int n = epoll_wait(p->fd, p->events, SERVER_EVENTS, timeout_ms);
+    for(int i = 0; i < n; i++) {
+        unsigned e = p->events[i].events;
+        out[i].watch = p->events[i].data.ptr;
+        out[i].events = ((e & EPOLLIN) ? WATCH_IN : 0) | ((e & EPOLLOUT) ? WATCH_OUT : 0) |
+                        ((e & (EPOLLHUP | EPOLLERR)) ? WATCH_HUP : 0);
+    }
+    return n > 0 ? n : 0;
+}
+
+#else
+
+// poll() fallback: a scan of every descriptor per wait
+typedef struct {
+    struct pollfd* fds;
+    Watch** watches;
+    int count;
+    int capacity;
+} Poller;
+
+static int poller_open(Poller* p) {
+    memset(p, 0, sizeof(Poller));
+    return 1;
+}
+
+static void poller_close(Poller* p) {
+    free(p->fds);
+    free(p->watches);
+}
+
+static short poll_events(unsigned events) {
+    return (short)(((events & WATCH_IN) ? POLLIN : 0) | ((events & WATCH_OUT) ? POLLOUT : 0));
+}
+
+static int poller_add(Poller* p, Watch* w, unsigned events) {
+    if (p->count == p->capacity) {
+        int capacity = p->capacity ? p->capacity * 2 : 64;
+        struct pollfd* fds = realloc(p->fds, capacity * sizeof(struct pollfd));
+        if (fds) p->fds = fds;
+        Watch** watches = realloc(p->watches, capacity * sizeof(Watch*));
+        if (watches) p->watches = watches;
+        if (!fds || !watches) return 0;
+        p->capacity = capacity;
+    }
+    w->slot = p->count++;
+    p->fds[w->slot].fd = w->fd;
+    p->fds[w->slot].events = poll_events(events);
+    p->fds[w->slot].revents = 0;
+    p->watches[w->slot] = w;
+    return 1;
+}
+
+static void poller_modify(Poller* p, Watch* w, unsigned events) { p->fds[w->slot].events = poll_events(events); }
+
+static void poller_remove(Poller* p, Watch* w) {
+    int last = --p->count;
+    p->fds[w->slot] = p->fds[last];
+    p->watches[w->slot] = p->watches[last];
+    p->watches[w->slot]->slot = w->slot;
+}
+
+static int poller_wait(Poller* p, PollEvent* out, int timeout_ms) {
+    int n = 0;
+    if (poll(p->fds, (nfds_t)p->count, timeout_ms) <= 0) return 0;
+    for(int i = 0; i < p->count && n < SERVER_EVENTS; i++) {
+        short e = p->fds[i].revents;
+        if (!e) continue;
+        out[n].watch = p->watches[i];
+        out[n].events = ((e & POLLIN) ? WATCH_IN : 0) | ((e & POLLOUT) ? WATCH_OUT : 0) |
+                        ((e & (POLLHUP | POLLERR | POLLNVAL)) ? WATCH_HUP : 0);
+        n++;
+    }
+    return n;
+}
+
+#endif
+
+struct Server {
+    const ServerModel* models;
+    int count;
+    int batch;
+    int window_us;
+    int threads;
+    int (*learn)(void* ctx, int model, const double* inputs, double target);
+    void* learn_ctx;
+
+    // Shared with the workers, under 'lock'
+    pthread_mutex_t lock;
+    pthread_cond_t ready;    // Work for an idle worker, or stopping
+    pthread_cond_t arrived;  // Newly extracted requests for the collecting worker
+    Request* extract_head;
+    Request* extract_tail;
+    int extract_queued;
+    Request* head[SERVER_MAX_MODELS];  // Score queues
+    Request* tail[SERVER_MAX_MODELS];
+    int score_queued;
+    unsigned long long seq;
+    int collecting;          // A worker is filling a batch
+    int busy;                // Workers extracting or scoring
+    int stopping;            // Workers exit once the queues are empty
+    Request* done;           // Answered by the workers, for the event loop
+    int wake[2];             // Pipe: a byte when 'done' stops being empty
+    ServerStats stats;
+
+    // Event loop only
+    Poller poller;
+    Watch listener;
+    Watch waker;
+    Connection* open;
+    Connection* paused;
+    int open_count;
+    Request* spare;
+    Request* outgoing;       // Read this round, not yet handed to the workers
+    Request* outgoing_tail;
+    int outgoing_count;
+    int inflight;
+    size_t text_bytes;
+    long long connections, answered, rejected, pauses;
+    NNArena* arena;          // Requests
+    int widest_in;
+};
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void record(ServerStats* stats, ServerStage stage, uint64_t start, uint64_t end) {
+    ServerLatency* l = &stats->stages[stage];
+    uint64_t ns = end > start ? end - start : 0;
+    l->count++;
+    l->ns += (long long)ns;
+    l->buckets[nn_stats_bucket(ns)]++;
+}
+
+static void answer_error(Request* r, const char* error) {
+    r->model = -1;
+    r->reply_length = (size_t)snprintf(r->reply, SERVER_REPLY, "error %s\n", error);
+}
+
+// --- Workers ---
+
+// Under 'lock': hands an answered request back to the event loop
+static void finish(Server* s, Request* r) {
+    if (!s->done) {
+        char byte = 0;
+        ssize_t ignored = write(s->wake[1], &byte, 1);  // Full pipe: the loop is awake anyway
+        (void)ignored;
+    }
+    r->next = s->done;
+    s->done = r;
+    s->stats.requests++;
+}
+
+// Model whose oldest queued request came first
+static int oldest_model(const Server* s) {
+    int best = -1;
+    for(int m = 0; m < s->count; m++) {
+        if (s->head[m] && (best < 0 || s->head[m]->seq < s->head[best]->seq)) best = m;
+    }
+    return best;
+}
+
+// Moves queued requests of 'model' into the batch, up to its size
+static int take(Server* s, Worker* w, int model, int n) {
+    while (n < s->batch && s->head[model]) {
+        Request* r = s->head[model];
+        s->head[model] = r->next;
+        if (!s->head[model]) s->tail[model] = NULL;
+        w->batch[n++] = r;
+        s->score_queued--;
+    }
+    return n;
+}
+
+// One worker collects at a time: it takes the oldest request's model and,
+// while other workers are busy (more requests are on their way), waits out
+// the window for more of it. An idle server answers at once.
+static int collect(Server* s, Worker* w, int* model) {
+    s->collecting = 1;
+    if (s->extract_head) pthread_cond_signal(&s->ready);
+    *model = oldest_model(s);
+    int n = take(s, w, *model, 0);
+    if (n < s->batch && s->window_us > 0 && s->busy > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += (long)s->window_us * 1000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        while (n < s->batch && !s->stopping &&
+               pthread_cond_timedwait(&s->arrived, &s->lock, &deadline) == 0) {
+            n = take(s, w, *model, n);
+        }
+        n = take(s, w, *model, n);
+    }
+    s->collecting = 0;
+    s->stats.batches++;
+    if (s->score_queued || s->extract_head) pthread_cond_signal(&s->ready);
+    return n;
+}
+
+// Returns 0 when the brain's new shape left no workspace to run it
+static int score_batch(Worker* w, int model, int n) {
+    const ServerModel* sm = &w->server->models[model];
+    const NeuralNetwork* nn = slot_pin(w->readers[model]);
+    if (!workspace_fits(w->ws[model], nn)) {
+        NNWorkspace* ws = create_workspace(nn);
+        if (!ws) {
+            slot_unpin(w->readers[model]);
+            for(int i = 0; i < n; i++) answer_error(w->batch[i], "out of memory");
+            return 0;
+        }
+        free_workspace(w->ws[model]);
+        w->ws[model] = ws;
+    }
+    int in = nn->input_nodes, out = nn->output_nodes;
+    for(int i = 0; i < n; i++) memcpy(w->inputs + (size_t)i * in, w->batch[i]->inputs, in * sizeof(double));
+    predict_batch_with_workspace(nn, w->ws[model], w->inputs, n, w->outputs);
+    slot_unpin(w->readers[model]);
+    for(int i = 0; i < n; i++) {
+        Request* r = w->batch[i];
+        memcpy(r->reply, "ok ", 3);
+        sm->format(r->reply + 3, SERVER_REPLY - 4, r->raw, w->outputs[(size_t)i * out]);
+        r->reply_length = strlen(r->reply);
+        r->reply[r->reply_length++] = '\n';
+    }
+    return 1;
+}
+
+// A record that parses to an infinity (e.g. "1e999") must not be learnt from
+static int finite_inputs(const Server* s, const Request* r) {
+    int n = slot_inputs(s->models[r->model].slot);
+    for(int i = 0; i < n; i++) {
+        if (!isfinite(r->inputs[i])) return 0;
+    }
+    return 1;
+}
+
+// Unlocked: runs each model's parse (the feature extraction), and hands
+// feedback on to the learner
+static void extract(Server* s, Request* list) {
+    for(Request* r = list; r; r = r->next) {
+        r->extract_at = now_ns();
+        if (!s->models[r->model].parse(r->text, r->length, r->raw, r->inputs)) {
+            answer_error(r, "malformed request");
+        } else if (r->learn && !finite_inputs(s, r)) {
+            answer_error(r, "malformed request");
+        } else if (r->learn) {
+            if (s->learn(s->learn_ctx, r->model, r->inputs, r->target)) {
+                r->reply_length = (size_t)snprintf(r->reply, SERVER_REPLY, "ok queued\n");
+            } else {
+                answer_error(r, "busy");
+            }
+        }
+        r->extracted_at = now_ns();
+    }
+}
+
+// Under 'lock': extracted requests -> score queues, feedback and malformed
+// ones -> done
+static void route(Server* s, Request* list) {
+    int scorable = 0;
+    while (list) {
+        Request* r = list;
+        list = r->next;
+        record(&s->stats, SERVER_STAGE_QUEUE, r->read_at, r->extract_at);
+        record(&s->stats, SERVER_STAGE_EXTRACT, r->extract_at, r->extracted_at);
+        if (r->model < 0 || r->learn) {
+            if (r->model < 0) s->stats.errors++;
+            finish(s, r);
+            continue;
+        }
+        r->next = NULL;
+        r->seq = s->seq++;
+        if (s->tail[r->model]) s->tail[r->model]->next = r;
+        else s->head[r->model] = r;
+        s->tail[r->model] = r;
+        s->score_queued++;
+        scorable++;
+    }
+    if (scorable && s->collecting) pthread_cond_signal(&s->arrived);
+}
+
+// Scoring comes first so the pipeline drains; otherwise a worker extracts a
+// share of the queue
+static void* worker_main(void* arg) {
+    Worker* w = arg;
+    Server* s = w->server;
+    pthread_mutex_lock(&s->lock);
+    while (1) {
+        if (!s->collecting && s->score_queued) {
+            int model;
+            int n = collect(s, w, &model);
+            s->busy++;
+            pthread_mutex_unlock(&s->lock);
+            uint64_t start = now_ns();
+            int scored = score_batch(w, model, n);
+            uint64_t end = now_ns();
+            pthread_mutex_lock(&s->lock);
+            s->busy--;
+            if (!scored) s->stats.errors += n;
+            for(int i = 0; i < n; i++) {
+                Request* r = w->batch[i];
+                record(&s->stats, SERVER_STAGE_BATCH, r->extracted_at, start);
+                record(&s->stats, SERVER_STAGE_SCORE, start, end);
+                record(&s->stats, SERVER_STAGE_TOTAL, r->read_at, end);
+                finish(s, r);
+            }
+        } else if (s->extract_head) {
+            int share = s->extract_queued / s->threads + 1;
+            if (share > SERVER_EXTRACT_CHUNK) share = SERVER_EXTRACT_CHUNK;
+            Request* list = s->extract_head;
+            Request* last = list;
+            for(int i = 1; i < share && last->next; i++) last = last->next;
+            s->extract_head = last->next;
+            if (!s->extract_head) s->extract_tail = NULL;
+            last->next = NULL;
+            for(Request* r = list; r; r = r->next) s->extract_queued--;
+            if (s->extract_head) pthread_cond_signal(&s->ready);
+            s->busy++;
+            pthread_mutex_unlock(&s->lock);
+            extract(s, list);
+            pthread_mutex_lock(&s->lock);
+            s->busy--;
+            route(s, list);
+        } else if (s->stopping) {
+            break;
+        } else {
+            pthread_cond_wait(&s->ready, &s->lock);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static int start_worker(Server* s, Worker* w) {
+    int widest_in = 1, widest_out = 1;
+    w->server = s;
+    w->arena = create_arena(0);
+    if (!w->arena) return 0;
+    for(int m = 0; m < s->count; m++) {
+        NNModelSlot* slot = s->models[m].slot;
+        if (!(w->readers[m] = slot_reader(slot))) return 0;
+        w->ws[m] = create_workspace(slot_pin(w->readers[m]));
+        slot_unpin(w->readers[m]);
+        if (!w->ws[m]) return 0;
+        if (slot_inputs(slot) > widest_in) widest_in = slot_inputs(slot);
+        if (slot_outputs(slot) > widest_out) widest_out = slot_outputs(slot);
+    }
+    w->batch = arena_alloc(w->arena, s->batch * sizeof(Request*));
+    w->inputs = arena_alloc(w->arena, (size_t)s->batch * widest_in * sizeof(double));
+    w->outputs = arena_alloc(w->arena, (size_t)s->batch * widest_out * sizeof(double));
+    return w->batch && w->inputs && w->outputs && pthread_create(&w->thread, NULL, worker_main, w) == 0;
+}
+
+static void free_worker(Worker* w) {
+    for(int m = 0; m < w->server->count; m++) free_workspace(w->ws[m]);
+    free_arena(w->arena);
+}
+
+// --- Requests (event loop) ---
+
+static void snapshot(Server* s, ServerStats* stats) {
+    pthread_mutex_lock(&s->lock);
+    *stats = s->stats;
+    stats->extract_queue = s->extract_queued;
+    stats->score_queue = s->score_queued;
+    pthread_mutex_unlock(&s->lock);
+    stats->connections = s->connections;
+    stats->requests += s->answered;
+    stats->errors += s->rejected;
+    stats->pauses = s->pauses;
+    stats->open = s->open_count;
+    stats->inflight = s->inflight;
+}
+
+// Appended to the connection's requests; NULL when out of memory
+static Request* new_request(Server* s, Connection* c) {
+    if (!s->spare) {
+        Request* chunk = arena_alloc(s->arena, SERVER_POOL_CHUNK * sizeof(Request));
+        double* inputs = arena_alloc(s->arena, (size_t)SERVER_POOL_CHUNK * s->widest_in * sizeof(double));
+        if (!chunk || !inputs) return NULL;
+        for(int i = 0; i < SERVER_POOL_CHUNK; i++) {
+            chunk[i].inputs = inputs + (size_t)i * s->widest_in;
+            chunk[i].next = s->spare;
+            s->spare = &chunk[i];
+        }
+    }
+    Request* r = s->spare;
+    s->spare = r->next;
+    r->next = NULL;
+    r->after = NULL;
+    r->conn = c;
+    r->model = -1;
+    r->done = 0;
+    r->learn = 0;
+    r->text = r->inline_text;
+    r->length = 0;
+    r->read_at = now_ns();
+    if (c->tail) c->tail->after = r;
+    else c->head = r;
+    c->tail = r;
+    c->inflight++;
+    s->inflight++;
+    return r;
+}
+
+static void recycle(Server* s, Request* r) {
+    if (r->text != r->inline_text) free(r->text);
+    s->text_bytes -= r->length;
+    s->inflight--;
+    r->next = s->spare;
+    s->spare = r;
+}
+
+static int set_text(Server* s, Request* r, const char* text, size_t length) {
+    if (length >= SERVER_INLINE_TEXT && !(r->text = malloc(length + 1))) {
+        r->text = r->inline_text;
+        return 0;
+    }
+    memcpy(r->text, text, length);
+    r->text[length] = '\0';
+    r->length = length;
+    s->text_bytes += length;
+    return 1;
+}
+
+static void reject(Server* s, Request* r, const char* error) {
+    answer_error(r, error);
+    r->done = 1;
+    s->rejected++;
+}
+
+static void answer_stats(Server* s, Request* r) {
+    ServerStats st;
+    snapshot(s, &st);
+    int length = snprintf(r->reply, SERVER_REPLY,
+                          "ok open=%d inflight=%d extract_queue=%d score_queue=%d connections=%lld requests=%lld "
+                          "errors=%lld batches=%lld pauses=%lld",
+                          st.open, st.inflight, st.extract_queue, st.score_queue, st.connections, st.requests,
+                          st.errors, st.batches, st.pauses);
+    for(int stage = 0; stage < SERVER_STAGE_COUNT && length < SERVER_REPLY - 1; stage++) {
+        const ServerLatency* l = &st.stages[stage];
+        length += snprintf(r->reply + length, SERVER_REPLY - 1 - length, " %s_p50_us=%.1f %s_p99_us=%.1f",
+                           STAGE_NAMES[stage], server_latency_quantile(l, 0.5) / 1e3,
+                           STAGE_NAMES[stage], server_latency_quantile(l, 0.99) / 1e3);
+    }
+    if (length > SERVER_REPLY - 2) length = SERVER_REPLY - 2;
+    r->reply[length++] = '\n';
+    r->reply_length = (size_t)length;
+    r->done = 1;
+    s->answered++;
+}
+
+static int find_model(const Server* s, const char* name, size_t length) {
+    for(int m = 0; m < s->count; m++) {
+        if (strlen(s->models[m].name) == length && memcmp(s->models[m].name, name, length) == 0) return m;
+    }
+    return -1;
+}
+
+// Splits off the first word of 'text'; 'rest' starts at the next one
+static size_t next_word(char* text, char** rest) {
+    size_t length = strcspn(text, " \t");
+    char* after = text + length;
+    while (*after == ' ' || *after == '\t') after++;
+    *rest = after;
+    return length;
+}
+
+// "<model> <text>" or "learn <model> <label> <text>" -> a request for the
+// workers, or answered at once
+static void take_request(Server* s, Connection* c, char* line, size_t length) {
+    Request* r = new_request(s, c);
+    if (!r) {
+        c->eof = 1;
+        return;
+    }
+    if (c->discarding) {
+        c->discarding = 0;
+        reject(s, r, "request too long");
+        return;
+    }
+    char* text;
+    char* name = line;
+    size_t name_length = next_word(name, &text);
+    if (name_length == 0) {
+        reject(s, r, "empty request");
+        return;
+    }
+    if (name_length == 5 && memcmp(name, "stats", 5) == 0) {
+        answer_stats(s, r);
+        return;
+    }
+    if (name_length == 5 && memcmp(name, "learn", 5) == 0) {
+        if (!s->learn) {
+            reject(s, r, "learning is off");
+            return;
+        }
+        name = text;
+        name_length = next_word(name, &text);
+        char* end;
+        double label = strtod(text, &end);
+        if (end == text || (*end != ' ' && *end != '\t')) {
+            reject(s, r, "malformed request");
+            return;
+        }
+        next_word(text, &text);
+        r->learn = 1;
+        r->target = label;
+    }
+    int model = find_model(s, name, name_length);
+    if (model < 0) {
+        reject(s, r, "unknown model");
+        return;
+    }
+    if (r->learn) {
+        // Labels are scores the model could report: finite, 0..label_scale
+        double scale = s->models[model].label_scale;
+        if (!(r->target >= 0.0 && r->target <= scale)) {
+            reject(s, r, "malformed request");
+            return;
+        }
+        r->target /= scale;
+    }
+    if (!set_text(s, r, text, length - (size_t)(text - line))) {
+        reject(s, r, "out of memory");
+        return;
+    }
+    r->model = model;
+    if (s->outgoing_tail) s->outgoing_tail->next = r;
+    else s->outgoing = r;
+    s->outgoing_tail = r;
+    s->outgoing_count++;
+}
+
+// Hands the requests read this round to the workers
+static void submit(Server* s) {
+    if (!s->outgoing) return;
+    pthread_mutex_lock(&s->lock);
+    if (s->extract_tail) s->extract_tail->next = s->outgoing;
+    else s->extract_head = s->outgoing;
+    s->extract_tail = s->outgoing_tail;
+    s->extract_queued += s->outgoing_count;
+    pthread_cond_signal(&s->ready);
+    pthread_mutex_unlock(&s->lock);
+    s->outgoing = s->outgoing_tail = NULL;
+    s->outgoing_count = 0;
+}
+
+// --- Connections (event loop) ---
+
+static int server_room(const Server* s) {
+    return s->inflight < SERVER_MAX_INFLIGHT && s->text_bytes < SERVER_MAX_TEXT;
+}
+
+static int connection_room(const Connection* c) {
+    return c->inflight < SERVER_PIPELINE && c->out_length - c->out_start < SERVER_BACKLOG;
+}
+
+// Turns the complete lines received so far into requests, while there is room
+static void take_lines(Server* s, Connection* c) {
+    size_t start = 0;
+    while (!c->eof && start < c->in_length && connection_room(c) && server_room(s)) {
+        char* line = c->in + start;
+        char* nl = memchr(line, '\n', c->in_length - start);
+        if (!nl) break;
+        start = (size_t)(nl - c->in) + 1;
+        if (nl > line && nl[-1] == '\r') nl--;
+        *nl = '\0';
+        take_request(s, c, line, (size_t)(nl - line));
+    }
+    if (start == 0) return;
+    memmove(c->in, c->in + start, c->in_length - start);
+    c->in_length -= start;
+    if (c->in_length == 0) {
+        free(c->in);
+        c->in = NULL;
+        c->in_capacity = 0;
+    }
+}
+
+static void read_connection(Server* s, Connection* c) {
+    while (1) {
+        take_lines(s, c);
+        if (c->eof || !connection_room(c) || !server_room(s)) return;
+
+        // No complete line: make space, dropping a line that fills the buffer
+        if (c->in_length == c->in_capacity) {
+            if (c->in_capacity == SERVER_MAX_LINE) {
+                c->discarding = 1;
+                c->in_length = 0;
+            } else {
+                size_t capacity = c->in_capacity ? c->in_capacity * 2 : SERVER_BUFFER;
+                char* in = realloc(c->in, capacity < SERVER_MAX_LINE ? capacity : SERVER_MAX_LINE);
+                if (!in) {
+                    c->eof = 1;
+                    return;
+                }
+                c->in = in;
+                c->in_capacity = capacity < SERVER_MAX_LINE ? capacity : SERVER_MAX_LINE;
+            }
+        }
+        size_t space = c->in_capacity - c->in_length;
+        ssize_t got = recv(c->watch.fd, c->in + c->in_length, space, 0);
+        if (got > 0) {
+            c->in_length += (size_t)got;
+            if ((size_t)got < space) {  // Drained for now
+                take_lines(s, c);
+                return;
+            }
+            continue;
+        }
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        c->eof = 1;  // Hung up, or failed
+        if (got < 0) c->broken = 1;
+        return;
+    }
+}
+
+static void write_out(Connection* c) {
+    while (!c->broken && c->out_start < c->out_length) {
+        ssize_t sent = send(c->watch.fd, c->out + c->out_start, c->out_length - c->out_start, 0);
+        if (sent > 0) c->out_start += (size_t)sent;
+        else if (sent < 0 && errno == EINTR) continue;
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        else c->broken = 1;
+    }
+    free(c->out);
+    c->out = NULL;
+    c->out_start = c->out_length = c->out_capacity = 0;
+}
+
+static int append_out(Connection* c, const char* data, size_t length) {
+    if (c->out_length + length > c->out_capacity) {
+        size_t capacity = c->out_capacity ? c->out_capacity : SERVER_BUFFER;
+        while (capacity < c->out_length + length) capacity *= 2;
+        char* out = realloc(c->out, capacity);
+        if (!out) return 0;
+        c->out = out;
+        c->out_capacity = capacity;
+    }
+    memcpy(c->out + c->out_length, data, length);
+    c->out_length += length;
+    return 1;
+}
+
+// Sends the answered requests at the head of the connection, in order;
+// 0 when none were ready
+static int send_replies(Server* s, Connection* c) {
+    int sent = 0;
+    while (c->head && c->head->done) {
+        Request* r = c->head;
+        c->head = r->after;
+        if (!c->head) c->tail = NULL;
+        if (!c->broken && !append_out(c, r->reply, r->reply_length)) c->broken = 1;
+        c->inflight--;
+        recycle(s, r);
+        sent = 1;
+    }
+    if (sent) write_out(c);
+    return sent;
+}
+
+static void update_interest(Server* s, Connection* c) {
+    unsigned want = 0;
+    if (!c->eof && connection_room(c)) {
+        if (server_room(s)) {
+            want |= WATCH_IN;
+        } else if (!c->paused) {
+            c->paused = 1;
+            c->paused_next = s->paused;
+            s->paused = c;
+        }
+    }
+    if (c->out_start < c->out_length) want |= WATCH_OUT;
+    if (!c->eof && (c->events & WATCH_IN) && !(want & WATCH_IN)) s->pauses++;
+    if (c->registered && want != c->events) poller_modify(&s->poller, &c->watch, want);
+    c->events = want;
+}
+
+static void close_connection(Server* s, Connection* c) {
+    if (c->registered) poller_remove(&s->poller, &c->watch);
+    close(c->watch.fd);
+    if (c->prev) c->prev->next = c->next;
+    else s->open = c->next;
+    if (c->next) c->next->prev = c->prev;
+    s->open_count--;
+    if (c->paused) {
+        Connection** link = &s->paused;
+        while (*link != c) link = &(*link)->paused_next;
+        *link = c->paused_next;
+    }
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+// After any progress: takes what was read, sends what is answered, updates
+// the poller, and closes the connection once it has nothing left to do.
+// Replies make room for lines already buffered, which no read event recalls.
+static void settle(Server* s, Connection* c) {
+    do {
+        take_lines(s, c);
+    } while (send_replies(s, c));
+    update_interest(s, c);
+    if (c->eof && c->inflight == 0 && (c->broken || c->out_start == c->out_length)) close_connection(s, c);
+}
+
+static void handle_event(Server* s, Connection* c, unsigned events) {
+    if (events & WATCH_HUP) {
+        // Gone for good: requests in flight finish, their replies are dropped
+        c->eof = 1;
+        c->broken = 1;
+        poller_remove(&s->poller, &c->watch);
+        c->registered = 0;
+    } else {
+        if (events & WATCH_OUT) write_out(c);
+        if (events & WATCH_IN) read_connection(s, c);
+    }
+    settle(s, c);
+}
+
+// Replies from the workers -> their connections
+static void complete_requests(Server* s) {
+    char drain[64];
+    while (read(s->wake[0], drain, sizeof(drain)) > 0) {}
+    pthread_mutex_lock(&s->lock);
+    Request* r = s->done;
+    s->done = NULL;
+    pthread_mutex_unlock(&s->lock);
+
+    Connection* touched = NULL;
+    for(; r; r = r->next) {
+        r->done = 1;
+        if (!r->conn->touched) {
+            r->conn->touched = 1;
+            r->conn->touched_next = touched;
+            touched = r->conn;
+        }
+    }
+    while (touched) {
+        Connection* c = touched;
+        touched = c->touched_next;
+        c->touched = 0;
+        settle(s, c);
+    }
+}
+
+// Connections held back by the server's limits, once there is room again
+static void resume_paused(Server* s) {
+    while (s->paused && server_room(s)) {
+        Connection* c = s->paused;
+        s->paused = c->paused_next;
+        c->paused = 0;
+        settle(s, c);
+    }
+}
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static void accept_connections(Server* s) {
+    while (1) {
+        int fd = accept(s->listener.fd, NULL, NULL);
+        if (fd < 0 && errno == EINTR) continue;
+        if (fd < 0) return;
+        Connection* c = NULL;
+        if (s->open_count < SERVER_MAX_CONNECTIONS && set_nonblocking(fd)) c = calloc(1, sizeof(Connection));
+        if (c) {
+            c->watch.fd = fd;
+            c->registered = poller_add(&s->poller, &c->watch, WATCH_IN);
+        }
+        if (!c || !c->registered) {
+            ssize_t ignored = send(fd, "error busy\n", 11, 0);
+            (void)ignored;
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->events = WATCH_IN;
+        c->next = s->open;
+        if (s->open) s->open->prev = c;
+        s->open = c;
+        s->open_count++;
+        s->connections++;
+    }
+}
+
+// Stops reading: lines already received are still answered
+static void begin_shutdown(Server* s) {
+    poller_remove(&s->poller, &s->listener);
+    Connection* next;
+    for(Connection* c = s->open; c; c = next) {
+        next = c->next;
+        take_lines(s, c);
+        c->eof = 1;
+        settle(s, c);
+    }
+}
+
+static void serve(Server* s) {
+    PollEvent events[SERVER_EVENTS];
+    int stopping = 0;
+    while (!stopping || s->open_count) {
+        if (stop_requested && !stopping) {
+            fprintf(stderr, ">> Shutting down...\n");
+            stopping = 1;
+            begin_shutdown(s);
+        }
+        int woken = 0;
+        int n = poller_wait(&s->poller, events, SERVER_TICK_MS);
+        for(int i = 0; i < n; i++) {
+            Watch* w = events[i].watch;
+            if (w == &s->listener) accept_connections(s);
+            else if (w == &s->waker) woken = 1;
+            else handle_event(s, (Connection*)w, events[i].events);
+        }
+        // After the events: settling here may close connections listed above
+        if (woken) complete_requests(s);
+        resume_paused(s);
+        submit(s);
+    }
+}
+
+// --- Lifecycle ---
+
+static int listen_on(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path '%s' is too long.\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // A socket left behind by an earlier run is replaced, anything else is kept
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 1024) != 0 ||
+        !set_nonblocking(fd)) {
+        fprintf(stderr, "Error: cannot listen on '%s' (%s).\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_server(const char* path, const ServerModel* models, int count, const ServerOptions* options,
+               ServerStats* stats) {
+    memset(stats, 0, sizeof(ServerStats));
+    if (count <= 0 || count > SERVER_MAX_MODELS) return 0;
+
+    Server s;
+    memset(&s, 0, sizeof(s));
+    s.models = models;
+    s.count = count;
+    s.batch = options->batch > 0 ? options->batch : NN_BATCH_TILE;
+    if (s.batch > SERVER_MAX_BATCH) s.batch = SERVER_MAX_BATCH;
+    s.window_us = options->window_us > 0 ? options->window_us : 0;
+    s.threads = options->threads > 0 ? options->threads : nn_cpu_count();
+    s.learn = options->learn;
+    s.learn_ctx = options->learn_ctx;
+    s.widest_in = 1;
+    for(int m = 0; m < count; m++) {
+        if (slot_inputs(models[m].slot) > s.widest_in) s.widest_in = slot_inputs(models[m].slot);
+    }
+    s.arena = create_arena(0);
+    if (!s.arena) return 0;
+    if (pipe(s.wake) != 0 || !set_nonblocking(s.wake[0]) || !set_nonblocking(s.wake[1]) || !poller_open(&s.poller)) {
+        fprintf(stderr, "Error: cannot set up the event loop (%s).\n", strerror(errno));
+        free_arena(s.arena);
+        return 0;
+    }
+    s.listener.fd = listen_on(path);
+    s.waker.fd = s.wake[0];
+    int ok = s.listener.fd >= 0 && poller_add(&s.poller, &s.listener, WATCH_IN) && poller_add(&s.poller, &s.waker, WATCH_IN);
+    pthread_mutex_init(&s.lock, NULL);
+    pthread_cond_init(&s.ready, NULL);
+    pthread_cond_init(&s.arrived, NULL);
+
+    // Clients that hang up early must not kill the server
+    struct sigaction action, old_int, old_term, old_pipe;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    stop_requested = 0;
+    sigaction(SIGINT, &action, &old_int);
+    sigaction(SIGTERM, &action, &old_term);
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, &old_pipe);
+
+    Worker* workers = ok ? calloc(s.threads, sizeof(Worker)) : NULL;
+    int started = 0;
+    while (workers && started < s.threads && start_worker(&s, &workers[started])) started++;
+    if (workers && started < s.threads) free_worker(&workers[started]);
+
+    if (ok && started == s.threads) {
+        fprintf(stderr, ">> Serving %d model(s) on '%s' with %d workers (batch %d, window %d us)\n",
+                count, path, s.threads, s.batch, s.window_us);
+        serve(&s);
+    } else if (ok) {
+        fprintf(stderr, "Error: cannot start the server workers.\n");
+    }
+    if (s.listener.fd >= 0) {
+        close(s.listener.fd);
+        unlink(path);
+    }
+
+    pthread_mutex_lock(&s.lock);
+    s.stopping = 1;
+    pthread_cond_broadcast(&s.ready);
+    pthread_cond_broadcast(&s.arrived);
+    pthread_mutex_unlock(&s.lock);
+    for(int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        free_worker(&workers[i]);
+    }
+    free(workers);
+    snapshot(&s, stats);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    sigaction(SIGPIPE, &old_pipe, NULL);
+    pthread_mutex_destroy(&s.lock);
+    pthread_cond_destroy(&s.ready);
+    pthread_cond_destroy(&s.arrived);
+    poller_close(&s.poller);
+    close(s.wake[0]);
+    close(s.wake[1]);
+    free_arena(s.arena);
+    return ok && started == s.threads;
+}
+
+#endif
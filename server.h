@@ -0,0 +1,98 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include "nn.h"
+#include "nn_stats.h"
+#include "registry.h"
+
+// Local scoring service on a Unix domain socket (not available on Windows).
+// Clients send one request per line, "<model> <text>", and get one reply per
+// line in the same order: "ok <fields>" or "error <reason>". A connection may
+// send many requests before reading the replies. The request "stats" answers
+// with the server's counters, queue depths and stage latencies, and
+// "learn <model> <label> <text>" hands a labelled record to options->learn
+// ("ok queued").
+//
+// One event-loop thread (epoll on Linux, poll elsewhere) owns every
+// connection: it reads, splits lines and writes replies, so idle connections
+// cost a few hundred bytes and no thread. Requests then go through two stages
+// on a fixed pool of workers, each with its own workspaces: extract (the
+// model's parse, e.g. the spam scan) and score, where the worker that picks
+// up a request waits up to 'window_us' for more of the same model and runs
+// them all through one predict_batch call. Each batch pins the model's
+// current brain, so a brain swapped in meanwhile (see NNModelSlot) takes
+// over from the next batch on, without pausing the server. A connection with SERVER_PIPELINE
+// requests in flight, or any connection once the server holds
+// SERVER_MAX_INFLIGHT requests or SERVER_MAX_TEXT bytes, is not read until
+// replies drain.
+#define SERVER_RAW 8           // Values a parser may keep for its reply
+#define SERVER_MAX_MODELS 16
+#define SERVER_MAX_LINE 65536  // Longer requests are rejected
+#define SERVER_REPLY 512       // Longest reply line
+#define SERVER_PIPELINE 256    // Requests in flight per connection
+#define SERVER_MAX_INFLIGHT 4096
+#define SERVER_MAX_TEXT (16 << 20)  // Bytes of request text in flight
+
+typedef struct {
+    const char* name;         // First word of a request
+    NNModelSlot* slot;        // Current brain; may be swapped while serving
+    // Request text (NUL-terminated) -> network inputs; 0 if malformed
+    int (*parse)(const char* text, size_t length, double* raw, double* inputs);
+    // Reply fields for the first network output
+    void (*format)(char* reply, size_t size, const double* raw, double score);
+    double label_scale;       // Feedback labels are network outputs times this
+} ServerModel;
+
+typedef struct {
+    int threads;    // Workers, <= 0: one per core
+    int batch;      // Most requests per predict_batch, <= 0: NN_BATCH_TILE
+    int window_us;  // Wait for a fuller batch (0: score what is queued)
+    // Labelled feedback, called on a worker; 0 when it cannot be taken now.
+    // NULL: "learn" requests are refused.
+    int (*learn)(void* ctx, int model, const double* inputs, double target);
+    void* learn_ctx;
+} ServerOptions;
+
+// Request stages, timed from the previous one
+typedef enum {
+    SERVER_STAGE_QUEUE,    // Read -> picked up for extraction
+    SERVER_STAGE_EXTRACT,  // Model's parse
+    SERVER_STAGE_BATCH,    // Extracted -> its batch starts (score queue and window)
+    SERVER_STAGE_SCORE,    // predict_batch and reply formatting
+    SERVER_STAGE_TOTAL,    // Read -> reply ready
+    SERVER_STAGE_COUNT
+} ServerStage;
+
+#define SERVER_BUCKETS NN_STATS_BUCKETS  // Bucket b counts requests of [2^b, 2^(b+1)) ns (nn_stats_bucket)
+
+typedef struct {
+    long long count;
+    long long ns;
+    long long buckets[SERVER_BUCKETS];
+} ServerLatency;
+
+typedef struct {
+    long long connections;
+    long long requests;  // Replies, errors included
+    long long errors;
+    long long batches;   // predict_batch calls
+    long long pauses;    // Connections left unread for backpressure
+    // Gauges when the snapshot was taken
+    int open;            // Connections
+    int inflight;        // Requests read but not yet replied to
+    int extract_queue;   // Waiting for extraction
+    int score_queue;     // Waiting for a batch
+    ServerLatency stages[SERVER_STAGE_COUNT];  // Answered requests, errors excluded
+} ServerStats;
+
+const char* server_stage_name(ServerStage stage);
+// Upper bound (ns) of the bucket holding the q-quantile, 0 when empty
+double server_latency_quantile(const ServerLatency* latency, double q);
+
+// Serves until SIGINT or SIGTERM, then answers the requests already read and
+// removes the socket. Returns 0 when the socket could not be set up.
+int run_server(const char* path, const ServerModel* models, int count, const ServerOptions* options,
+               ServerStats* stats);
+
+#endif
@@ -0,0 +1,465 @@
+#include <stdlib.h>
+#include <string.h>
+#include "spam.h"
+#include "nn_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPAM_X86 1
+#include <immintrin.h>
+#endif
+
+const SpamPattern SPAM_DEFAULT_PATTERNS[] = {
+    { "HTTP", SPAM_LINK }, { "WWW", SPAM_LINK }, { ".COM", SPAM_LINK },
+    { "FREE", SPAM_KEYWORD }, { "WINNER", SPAM_KEYWORD }, { "CASH", SPAM_KEYWORD },
+    { "URGENT", SPAM_KEYWORD }, { "CLICK", SPAM_KEYWORD }, { "PRIORITY", SPAM_KEYWORD },
+    { "OFFER", SPAM_KEYWORD }, { "SELECTED", SPAM_KEYWORD }, { "CREDIT", SPAM_KEYWORD },
+    { "$", SPAM_KEYWORD }, { "RISK", SPAM_KEYWORD }, { "BANK", SPAM_KEYWORD },
+};
+const int SPAM_DEFAULT_PATTERN_COUNT = sizeof(SPAM_DEFAULT_PATTERNS) / sizeof(SPAM_DEFAULT_PATTERNS[0]);
+
+struct SpamMatcher {
+    int classes;              // Byte classes: 0 for bytes in no pattern
+    int max_length;           // Longest pattern
+    unsigned char cls[256];   // Byte -> class, case-folded
+    int* next;                // next[offset + class] -> offset, offset = state * classes
+    int out_base;             // States with matches are numbered last: offsets >= out_base
+    int* out_links;           // Link matches ending in a state, by offset - out_base
+    uint64_t* out_hits;       // Patterns ending in a state (bit p = pattern p)
+    uint64_t keyword_mask;    // Bits of the keyword patterns
+
+    // Patterns, case-folded, for verifying the SIMD prefilter's candidates
+    int count;
+    unsigned char* text[SPAM_MAX_PATTERNS];
+    int length[SPAM_MAX_PATTERNS];
+    uint64_t link_mask;
+
+    // AVX2 prefilter: patterns spread over 8 buckets, and per bucket the
+    // nibbles its patterns allow at offsets 0..2 (bit b = bucket b)
+    int use_simd;
+    uint64_t bucket[8];
+    unsigned char nib_lo[3][16];
+    unsigned char nib_hi[3][16];
+};
+
+// Independent automaton walks interleaved over one buffer: each step is a
+// dependent table load, so one walk alone leaves the core mostly idle
+#define SPAM_LANES 4
+#define SPAM_LANE_MIN 256  // Bytes per lane below which a single walk is used
+
+// --- Lifecycle ---
+
+static unsigned char fold(unsigned char c) {
+    return c >= 'a' && c <= 'z' ? (unsigned char)(c - 'a' + 'A') : c;
+}
+
+SpamMatcher* create_spam_matcher(const SpamPattern* patterns, int count) {
+    if (count <= 0 || count > SPAM_MAX_PATTERNS) return NULL;
+
+    SpamMatcher* m = calloc(1, sizeof(SpamMatcher));
+    if (!m) return NULL;
+
+    // Alphabet: one class per distinct folded byte used by the patterns
+    int max_states = 1;
+    m->classes = 1;
+    for(int p = 0; p < count; p++) {
+        const unsigned char* t = (const unsigned char*)patterns[p].text;
+        if (!t || !*t) {
+            free(m);
+            return NULL;
+        }
+        int length = 0;
+        for(; *t; t++, length++) {
+            unsigned char c = fold(*t);
+            if (!m->cls[c]) m->cls[c] = (unsigned char)m->classes++;
+        }
+        if (length > SPAM_MAX_PATTERN_LENGTH) {
+            free(m);
+            return NULL;
+        }
+        max_states += length;
+        if (length > m->max_length) m->max_length = length;
+    }
+    for(int c = 0; c < 256; c++) m->cls[c] = m->cls[fold((unsigned char)c)];
+
+    // Automaton by state number first, laid out by offset at the end
+    int classes = m->classes;
+    int* next = calloc((size_t)max_states * classes, sizeof(int));
+    int* links = calloc(max_states, sizeof(int));
+    uint64_t* hits = calloc(max_states, sizeof(uint64_t));
+    int* fail = calloc(max_states, sizeof(int));
+    int* queue = malloc(max_states * sizeof(int));
+    int* order = malloc(max_states * sizeof(int));
+    int ok = next && links && hits && fail && queue && order;
+
+    // Trie (0 in next[] means "no edge" until the DFA is resolved)
+    int states = 1;
+    for(int p = 0; ok && p < count; p++) {
+        int s = 0;
+        for(const unsigned char* t = (const unsigned char*)patterns[p].text; *t; t++) {
+            int* edge = &next[s * classes + m->cls[*t]];
+            if (!*edge) *edge = states++;
+            s = *edge;
+        }
+        hits[s] |= (uint64_t)1 << p;
+        if (patterns[p].kind == SPAM_LINK) links[s]++;
+        else m->keyword_mask |= (uint64_t)1 << p;
+    }
+
+    // Breadth-first: failure links, inherited outputs, missing edges resolved
+    // through the failure state so scanning is one lookup per byte
+    int head = 0, tail = 0;
+    for(int c = 1; ok && c < classes; c++) {
+        if (next[c]) queue[tail++] = next[c];
+    }
+    while (head < tail) {
+        int s = queue[head++];
+        links[s] += links[fail[s]];
+        hits[s] |= hits[fail[s]];
+        for(int c = 1; c < classes; c++) {
+            int* edge = &next[s * classes + c];
+            int via_fail = next[fail[s] * classes + c];
+            if (*edge) {
+                fail[*edge] = via_fail;
+                queue[tail++] = *edge;
+            } else {
+                *edge = via_fail;
+            }
+        }
+    }
+
+    // Renumber: states without matches first (the root stays 0)
+    if (ok) {
+        int quiet = 0;
+        for(int s = 0; s < states; s++) if (!hits[s]) order[s] = quiet++;
+        int loud = quiet;
+        for(int s = 0; s < states; s++) if (hits[s]) order[s] = loud++;
+
+        m->out_base = quiet * classes;
+        m->next = malloc((size_t)states * classes * sizeof(int));
+        m->out_links = calloc((size_t)(states - quiet) * classes + 1, sizeof(int));
+        m->out_hits = calloc((size_t)(states - quiet) * classes + 1, sizeof(uint64_t));
+        ok = m->next && m->out_links && m->out_hits;
+        for(int s = 0; ok && s < states; s++) {
+            int offset = order[s] * classes;
+            for(int c = 0; c < classes; c++) m->next[offset + c] = order[next[s * classes + c]] * classes;
+            if (hits[s]) {
+                m->out_links[offset - m->out_base] = links[s];
+                m->out_hits[offset - m->out_base] = hits[s];
+            }
+        }
+    }
+    free(next);
+    free(links);
+    free(hits);
+    free(fail);
+    free(queue);
+    free(order);
+
+    // Folded copies and prefilter tables; offsets past a pattern's end accept anything
+    int short_count = 0, short_seen = 0, long_seen = 0;
+    for(int p = 0; p < count; p++) short_count += strlen(patterns[p].text) < 3;
+    for(int p = 0; ok && p < count; p++) {
+        int length = (int)strlen(patterns[p].text);
+        m->text[p] = malloc(length);
+        if (!m->text[p]) {
+            ok = 0;
+            break;
+        }
+        m->count++;
+        m->length[p] = length;
+        for(int k = 0; k < length; k++) m->text[p][k] = fold((unsigned char)patterns[p].text[k]);
+        if (patterns[p].kind == SPAM_LINK) m->link_mask |= (uint64_t)1 << p;
+
+        // Short patterns accept any byte at the offsets they do not cover, so
+        // they get buckets of their own where possible to keep buckets selective
+        int b = short_count < 8 ? (length < 3 ? short_seen++ % 8 : short_count + long_seen++ % (8 - short_count))
+                                : p % 8;
+        unsigned char bit = (unsigned char)(1u << b);
+        m->bucket[b] |= (uint64_t)1 << p;
+        for(int k = 0; k < 3; k++) {
+            if (k >= length) {
+                for(int n = 0; n < 16; n++) {
+                    m->nib_lo[k][n] |= bit;
+                    m->nib_hi[k][n] |= bit;
+                }
+                continue;
+            }
+            unsigned char c = m->text[p][k];
+            unsigned char variants[2] = { c, c >= 'A' && c <= 'Z' ? (unsigned char)(c + 32) : c };
+            for(int v = 0; v < 2; v++) {
+                m->nib_lo[k][variants[v] & 15] |= bit;
+                m->nib_hi[k][variants[v] >> 4] |= bit;
+            }
+        }
+    }
+    const char* level = nn_kernels()->name;
+    m->use_simd = strcmp(level, "avx2") == 0 || strcmp(level, "avx512") == 0;
+
+    if (!ok) {
+        free_spam_matcher(m);
+        return NULL;
+    }
+    return m;
+}
+
+void free_spam_matcher(SpamMatcher* m) {
+    if (!m) return;
+    for(int p = 0; p < m->count; p++) free(m->text[p]);
+    free(m->next);
+    free(m->out_links);
+    free(m->out_hits);
+    free(m);
+}
+
+// --- Operations ---
+
+// One automaton step; matches only cost anything in the rare output states
+#define SPAM_STEP(s, c, links, seen) do { \
+    s = next[s + cls[c]]; \
+    if (s >= out_base) { \
+        links += m->out_links[s - out_base]; \
+        seen |= m->out_hits[s - out_base]; \
+    } \
+} while (0)
+
+// Walks p[0..n) from offset *state, adding the matches to links/seen
+static void scan_bytes(const SpamMatcher* m, const unsigned char* p, size_t n,
+                       int* state, size_t* links, uint64_t* seen) {
+    const int* next = m->next;
+    const unsigned char* cls = m->cls;
+    int out_base = m->out_base;
+    size_t warm = (size_t)m->max_length - 1;
+    size_t lane = n / SPAM_LANES;
+    size_t done = 0;
+    int s0 = *state;
+    size_t l0 = 0;
+    uint64_t h0 = 0;
+
+    if (lane >= SPAM_LANE_MIN && lane > warm) {
+        // Lanes 1..3 start from the root a pattern length early, which puts
+        // them in the exact state by the first byte they count
+        const unsigned char* p1 = p + lane;
+        const unsigned char* p2 = p + 2 * lane;
+        const unsigned char* p3 = p + 3 * lane;
+        int s1 = 0, s2 = 0, s3 = 0;
+        for(size_t i = warm; i > 0; i--) {
+            s1 = next[s1 + cls[p1[-(ptrdiff_t)i]]];
+            s2 = next[s2 + cls[p2[-(ptrdiff_t)i]]];
+            s3 = next[s3 + cls[p3[-(ptrdiff_t)i]]];
+        }
+        size_t l1 = 0, l2 = 0, l3 = 0;
+        uint64_t h1 = 0, h2 = 0, h3 = 0;
+        for(size_t i = 0; i < lane; i++) {
+            SPAM_STEP(s0, p[i], l0, h0);
+            SPAM_STEP(s1, p1[i], l1, h1);
+            SPAM_STEP(s2, p2[i], l2, h2);
+            SPAM_STEP(s3, p3[i], l3, h3);
+        }
+        // Lane 3 finishes the tail
+        s0 = s3;
+        l0 += l1 + l2 + l3;
+        h0 |= h1 | h2 | h3;
+        done = 4 * lane;
+    }
+    for(size_t i = done; i < n; i++) SPAM_STEP(s0, p[i], l0, h0);
+
+    *state = s0;
+    *links += l0;
+    *seen |= h0;
+}
+
+#ifdef SPAM_X86
+
+/* --- AVX2 prefilter ("Teddy") ---
+   Each 32-byte block is matched against the nibble tables of the first three
+   pattern bytes with pshufb; a byte of the result is non-zero only where some
+   bucket's patterns could start. Those few positions are verified exactly. */
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+// Full compare of the candidate buckets' patterns at p[pos]
+static void verify_candidates(const SpamMatcher* m, unsigned buckets, const unsigned char* p,
+                              size_t pos, size_t n, size_t* links, uint64_t* seen) {
+    for(; buckets; buckets &= buckets - 1) {
+        for(uint64_t pats = m->bucket[__builtin_ctz(buckets)]; pats; pats &= pats - 1) {
+            int k = __builtin_ctzll(pats);
+            const unsigned char* t = m->text[k];
+            size_t len = m->length[k];
+            if (pos + len > n) continue;
+            size_t j = 0;
+            while (j < len && fold(p[pos + j]) == t[j]) j++;
+            if (j < len) continue;
+            *seen |= (uint64_t)1 << k;
+            if (m->link_mask >> k & 1) (*links)++;
+        }
+    }
+}
+
+TARGET_AVX2 static inline __m256i candidates_avx2(const __m256i lo[3], const __m256i hi[3], const unsigned char* at) {
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    __m256i result = _mm256_set1_epi8(-1);
+    for(int k = 0; k < 3; k++) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(at + k));
+        __m256i l = _mm256_shuffle_epi8(lo[k], _mm256_and_si256(x, low_nibble));
+        __m256i h = _mm256_shuffle_epi8(hi[k], _mm256_and_si256(_mm256_srli_epi16(x, 4), low_nibble));
+        result = _mm256_and_si256(result, _mm256_and_si256(l, h));
+    }
+    return result;
+}
+
+// 'A'..'Z' bytes of a block, as four 64-bit partial sums
+TARGET_AVX2 static inline __m256i caps_avx2(__m256i x) {
+    __m256i shifted = _mm256_add_epi8(x, _mm256_set1_epi8((char)(128 - 'A')));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+    return _mm256_sad_epu8(_mm256_and_si256(upper, _mm256_set1_epi8(1)), _mm256_setzero_si256());
+}
+
+// Counts the matches that lie entirely inside p[0..n)
+TARGET_AVX2 static void scan_avx2(const SpamMatcher* m, const unsigned char* p, size_t n, SpamFeatures* f) {
+    __m256i lo[3], hi[3];
+    for(int k = 0; k < 3; k++) {
+        lo[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m->nib_lo[k]));
+        hi[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m->nib_hi[k]));
+    }
+    __m256i caps = _mm256_setzero_si256();
+    size_t links = 0;
+    uint64_t seen = 0;
+
+    // Blocks read 2 bytes ahead; the rest goes through a zero-padded copy
+    size_t i = 0;
+    for(; i + 34 <= n; i += 32) {
+        caps = _mm256_add_epi64(caps, caps_avx2(_mm256_loadu_si256((const __m256i*)(p + i))));
+        __m256i cand = candidates_avx2(lo, hi, p + i);
+        unsigned hits = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cand, _mm256_setzero_si256()));
+        if (!hits) continue;
+        unsigned char buckets[32];
+        _mm256_storeu_si256((__m256i*)buckets, cand);
+        for(; hits; hits &= hits - 1) {
+            int j = __builtin_ctz(hits);
+            verify_candidates(m, buckets[j], p, i + j, n, &links, &seen);
+        }
+    }
+    unsigned char tail[66] = {0};
+    memcpy(tail, p + i, n - i);
+    for(size_t at = 0; i + at < n; at += 32) {
+        caps = _mm256_add_epi64(caps, caps_avx2(_mm256_loadu_si256((const __m256i*)(tail + at))));
+        unsigned char buckets[32];
+        _mm256_storeu_si256((__m256i*)buckets, candidates_avx2(lo, hi, tail + at));
+        for(size_t j = 0; j < 32 && i + at + j < n; j++) {
+            if (buckets[j]) verify_candidates(m, buckets[j], p, i + at + j, n, &links, &seen);
+        }
+    }
+
+    uint64_t sums[4];
+    _mm256_storeu_si256((__m256i*)sums, caps);
+    f->caps += (size_t)(sums[0] + sums[1] + sums[2] + sums[3]);
+    f->links += links;
+    f->seen |= seen;
+}
+
+#endif
+
+// Matches that start in the carried tail of the previous block and end in
+// the first bytes of this one (the SIMD scan only sees whole-block matches)
+static void scan_boundary(SpamStream* st, const unsigned char* p, size_t n) {
+    const SpamMatcher* m = st->matcher;
+    unsigned char joint[2 * SPAM_MAX_PATTERN_LENGTH];
+    size_t head = n < (size_t)m->max_length - 1 ? n : (size_t)m->max_length - 1;
+    memcpy(joint, st->carry, st->carried);
+    memcpy(joint + st->carried, p, head);
+
+    for(size_t pos = 0; pos < st->carried; pos++) {
+        for(int k = 0; k < m->count; k++) {
+            size_t end = pos + m->length[k];
+            if (end <= st->carried || end > st->carried + head) continue;
+            size_t j = 0;
+            while (j < (size_t)m->length[k] && fold(joint[pos + j]) == m->text[k][j]) j++;
+            if (j < (size_t)m->length[k]) continue;
+            st->features.seen |= (uint64_t)1 << k;
+            if (m->link_mask >> k & 1) st->features.links++;
+        }
+    }
+
+    // Keep the last max_length - 1 bytes seen for the next block
+    size_t keep = (size_t)m->max_length - 1;
+    if (n >= keep) {
+        memcpy(st->carry, p + n - keep, keep);
+    } else {
+        size_t old = st->carried + n > keep ? st->carried + n - keep : 0;
+        memmove(st->carry, st->carry + old, st->carried - old);
+        memcpy(st->carry + st->carried - old, p, n);
+        n += st->carried - old;
+    }
+    st->carried = n < keep ? n : keep;
+}
+
+static void scan_block(SpamStream* st, const unsigned char* p, size_t n) {
+    const SpamMatcher* m = st->matcher;
+    SpamFeatures* f = &st->features;
+    f->length += n;
+
+#ifdef SPAM_X86
+    if (m->use_simd) {
+        scan_avx2(m, p, n, f);
+        scan_boundary(st, p, n);
+        return;
+    }
+#endif
+    // Branch-free, so the compiler vectorizes it
+    size_t caps = 0;
+    for(size_t i = 0; i < n; i++) caps += (unsigned char)(p[i] - 'A') < 26;
+    f->caps += caps;
+    scan_bytes(m, p, n, &st->state, &f->links, &f->seen);
+}
+
+void spam_stream_begin(SpamStream* st, const SpamMatcher* m) {
+    memset(&st->features, 0, sizeof(st->features));
+    st->matcher = m;
+    st->state = 0;
+    st->carried = 0;
+    st->pending = 0;
+}
+
+void spam_stream_feed(SpamStream* st, const char* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+
+    // Small pieces are gathered so the scan always works on large blocks
+    if (st->pending + length < SPAM_STREAM_BLOCK) {
+        memcpy(st->buffer + st->pending, p, length);
+        st->pending += length;
+        return;
+    }
+    if (st->pending) {
+        size_t fill = SPAM_STREAM_BLOCK - st->pending;
+        memcpy(st->buffer + st->pending, p, fill);
+        scan_block(st, st->buffer, SPAM_STREAM_BLOCK);
+        st->pending = 0;
+        p += fill;
+        length -= fill;
+    }
+    // Whole blocks straight from the caller's memory, the rest is kept
+    size_t direct = length - length % SPAM_STREAM_BLOCK;
+    if (direct) scan_block(st, p, direct);
+    memcpy(st->buffer, p + direct, length - direct);
+    st->pending = length - direct;
+}
+
+void spam_stream_end(SpamStream* st, SpamFeatures* features) {
+    if (st->pending) scan_block(st, st->buffer, st->pending);
+    st->pending = 0;
+    *features = st->features;
+    features->keywords = 0;
+    for(uint64_t k = features->seen & st->matcher->keyword_mask; k; k &= k - 1) features->keywords++;
+}
+
+void spam_scan(const SpamMatcher* m, const char* text, size_t length, SpamFeatures* features) {
+    SpamStream st;
+    spam_stream_begin(&st, m);
+    spam_stream_feed(&st, text, length);
+    spam_stream_end(&st, features);
+}
+
+void spam_feature_vector(const SpamFeatures* f, double out[3]) {
+    out[0] = (double)f->links;
+    out[1] = f->length ? ((double)f->caps / f->length) * 100.0 : 0.0;
+    out[2] = f->keywords;
+}
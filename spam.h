@@ -0,0 +1,67 @@
+#ifndef SPAM_H
+#define SPAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Spam-Guard feature extraction: one pass over the text counts the uppercase
+// letters, link markers and keywords together, case-insensitively and without
+// modifying the text. With AVX2 a SIMD prefilter flags the few positions where
+// a pattern may start and only those are compared; otherwise an Aho-Corasick
+// automaton (compiled to a DFA over case-folded bytes) walks every byte.
+#define SPAM_MAX_PATTERNS 64
+#define SPAM_MAX_PATTERN_LENGTH 64
+
+typedef enum {
+    SPAM_LINK = 0,    // Every occurrence counts, overlapping ones included
+    SPAM_KEYWORD = 1  // Counts once per message, however often it appears
+} SpamPatternKind;
+
+typedef struct {
+    const char* text;  // Matched case-insensitively
+    SpamPatternKind kind;
+} SpamPattern;
+
+// The Spam-Guard list: HTTP/WWW/.COM links and 12 money/urgency keywords
+extern const SpamPattern SPAM_DEFAULT_PATTERNS[];
+extern const int SPAM_DEFAULT_PATTERN_COUNT;
+
+typedef struct SpamMatcher SpamMatcher;
+
+typedef struct {
+    size_t length;    // Bytes scanned
+    size_t caps;      // Uppercase letters
+    size_t links;     // Link pattern occurrences
+    uint64_t seen;    // Bit p set once pattern p has matched
+    int keywords;     // Distinct keyword patterns seen
+} SpamFeatures;
+
+// Incremental scan of one message fed in pieces of any size (lines, file
+// chunks, ...): constant memory per message and linear time, with matches
+// spanning piece boundaries still found. Lives on the caller's stack.
+#define SPAM_STREAM_BLOCK 4096
+
+typedef struct {
+    const SpamMatcher* matcher;
+    SpamFeatures features;  // Running totals
+    int state;              // Automaton state between blocks
+    size_t carried;         // Tail of the previous block (SIMD scan)
+    unsigned char carry[SPAM_MAX_PATTERN_LENGTH];
+    size_t pending;         // Fed bytes not yet scanned
+    unsigned char buffer[SPAM_STREAM_BLOCK];
+} SpamStream;
+
+// --- Lifecycle ---
+SpamMatcher* create_spam_matcher(const SpamPattern* patterns, int count);  // NULL if invalid
+void free_spam_matcher(SpamMatcher* matcher);
+
+// --- Operations ---
+void spam_scan(const SpamMatcher* matcher, const char* text, size_t length, SpamFeatures* features);
+
+void spam_stream_begin(SpamStream* stream, const SpamMatcher* matcher);  // Also restarts a stream
+void spam_stream_feed(SpamStream* stream, const char* data, size_t length);
+void spam_stream_end(SpamStream* stream, SpamFeatures* features);
+// Network inputs before scaling: links, caps percentage, keywords
+void spam_feature_vector(const SpamFeatures* features, double out[3]);
+
+#endif
@@ -0,0 +1,218 @@
+#include <pthread.h>
+#include "trainer.h"
+#include "nn_stats.h"
+
+// Reusable barrier (pthread_barrier_t is not available everywhere)
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+    int waiting;
+    unsigned generation;
+} Barrier;
+
+typedef struct {
+    NNTrainer* owner;
+    int index;
+    NNWorkspace* ws;
+    pthread_t thread;
+} Worker;
+
+struct NNTrainer {
+    NeuralNetwork* nn;
+    int threads;
+    Worker* workers;  // workers[0] is the calling thread
+
+    // Current job, published under 'lock'
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    unsigned job;
+    int stop;
+    const double* inputs;
+    const double* targets;
+    int n;
+    int active;  // Workers taking part in this step
+
+    Barrier barrier;
+};
+
+// --- Barrier ---
+
+static void barrier_init(Barrier* b, int count) {
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->cond, NULL);
+    b->count = count;
+    b->waiting = 0;
+    b->generation = 0;
+}
+
+// Only called between steps, when no thread is inside the barrier
+static void barrier_resize(Barrier* b, int count) {
+    pthread_mutex_lock(&b->lock);
+    b->count = count;
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void barrier_destroy(Barrier* b) {
+    pthread_mutex_destroy(&b->lock);
+    pthread_cond_destroy(&b->cond);
+}
+
+static void barrier_wait(Barrier* b) {
+    pthread_mutex_lock(&b->lock);
+    unsigned gen = b->generation;
+    if (++b->waiting == b->count) {
+        b->waiting = 0;
+        b->generation++;
+        pthread_cond_broadcast(&b->cond);
+    } else {
+        while (gen == b->generation) pthread_cond_wait(&b->cond, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+// --- Worker ---
+
+// Shard the batch, accumulate local gradients, then tree-reduce into worker 0
+static void run_shard(Worker* w) {
+    NNTrainer* t = w->owner;
+    int active = t->active;
+    int begin = (int)((long long)t->n * w->index / active);
+    int end = (int)((long long)t->n * (w->index + 1) / active);
+
+    zero_gradients(w->ws);
+    accumulate_gradients(t->nn, w->ws,
+                         t->inputs + (size_t)begin * t->nn->input_nodes,
+                         t->targets + (size_t)begin * t->nn->output_nodes,
+                         end - begin);
+
+    // Pairwise reduction: fixed pairing, so the sum order never changes
+    for(int step = 1; step < active; step *= 2) {
+        barrier_wait(&t->barrier);
+        if (w->index % (2 * step) == 0 && w->index + step < active) {
+            add_gradients(w->ws, t->workers[w->index + step].ws);
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = arg;
+    NNTrainer* t = w->owner;
+    unsigned seen = 0;
+
+    while (1) {
+        pthread_mutex_lock(&t->lock);
+        while (t->job == seen && !t->stop) pthread_cond_wait(&t->start, &t->lock);
+        if (t->stop) {
+            pthread_mutex_unlock(&t->lock);
+            break;
+        }
+        seen = t->job;
+        int joined = w->index < t->active;
+        pthread_mutex_unlock(&t->lock);
+
+        if (joined) {
+            run_shard(w);
+            barrier_wait(&t->barrier);  // Step finished
+        }
+    }
+    return NULL;
+}
+
+// --- Lifecycle ---
+
+NNTrainer* create_trainer(NeuralNetwork* nn, int threads) {
+    if (threads <= 0) threads = nn_cpu_count();
+
+    NNTrainer* t = calloc(1, sizeof(NNTrainer));
+    if (!t) return NULL;
+    t->nn = nn;
+    t->workers = calloc(threads, sizeof(Worker));
+    if (!t->workers) {
+        free(t);
+        return NULL;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->start, NULL);
+    barrier_init(&t->barrier, 1);
+
+    for(int i = 0; i < threads; i++) {
+        Worker* w = &t->workers[i];
+        w->owner = t;
+        w->index = i;
+        w->ws = create_workspace(nn);
+        if (!w->ws) break;
+        // Worker 0 runs on the caller's thread inside trainer_step()
+        if (i > 0 && pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+            free_workspace(w->ws);
+            w->ws = NULL;
+            break;
+        }
+        t->threads++;
+    }
+    if (t->threads == 0) {
+        free_trainer(t);
+        return NULL;
+    }
+    return t;
+}
+
+void free_trainer(NNTrainer* t) {
+    if (!t) return;
+    pthread_mutex_lock(&t->lock);
+    t->stop = 1;
+    pthread_cond_broadcast(&t->start);
+    pthread_mutex_unlock(&t->lock);
+
+    for(int i = 0; i < t->threads; i++) {
+        if (i > 0) pthread_join(t->workers[i].thread, NULL);
+        free_workspace(t->workers[i].ws);
+    }
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->start);
+    barrier_destroy(&t->barrier);
+    free(t->workers);
+    free(t);
+}
+
+int trainer_threads(const NNTrainer* t) {
+    return t->threads;
+}
+
+// --- Operations ---
+
+void trainer_step(NNTrainer* t, const double* inputs, const double* targets, int n, double learning_rate) {
+    if (n <= 0) return;
+    NeuralNetwork* nn = t->nn;
+
+    // Only split when every worker gets enough work to pay for the hand-off
+    long long macs = 0;
+    for(int l = 0; l < nn->num_layers; l++) macs += (long long)nn->layers[l].inputs * nn->layers[l].neurons;
+    long long useful = (long long)n * macs * 3 / TRAINER_MIN_SHARD_MACS;  // fwd + bwd + grad
+    int active = useful < t->threads ? (int)useful : t->threads;
+    if (active > n) active = n;
+
+    if (active <= 1) {
+        train_batch(nn, t->workers[0].ws, inputs, targets, n, learning_rate);
+        return;
+    }
+
+    uint64_t start = nn_stats_begin();
+    pthread_mutex_lock(&t->lock);
+    t->inputs = inputs;
+    t->targets = targets;
+    t->n = n;
+    t->active = active;
+    barrier_resize(&t->barrier, active);
+    t->job++;
+    pthread_cond_broadcast(&t->start);
+    pthread_mutex_unlock(&t->lock);
+
+    run_shard(&t->workers[0]);
+    barrier_wait(&t->barrier);
+
+    apply_gradients(nn, t->workers[0].ws, learning_rate / n);
+    // Same count as train_batch: forward, gradients, backward past the first layer, update
+    long long first = (long long)nn->layers[0].inputs * nn->layers[0].neurons;
+    if (start) nn_stats_op(NN_OP_TRAIN_BATCH, start, 0, n, 2 * (n * (3 * macs - first) + macs));
+}
@@ -0,0 +1,27 @@
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include "nn.h"
+
+// Minimum multiply-adds per worker before a batch is split across threads.
+// Below this the hand-off costs more than the work, so small batches stay
+// on the calling thread.
+#define TRAINER_MIN_SHARD_MACS 32768
+
+// Data-parallel mini-batch trainer.
+// Each step shards the batch across a fixed pool of threads, every thread
+// accumulates gradients into its own workspace, the partial gradients are
+// combined with a pairwise tree reduction and one update is applied.
+// For a fixed thread count the result is deterministic.
+typedef struct NNTrainer NNTrainer;
+
+// --- Lifecycle ---
+NNTrainer* create_trainer(NeuralNetwork* nn, int threads);  // threads <= 0: one per core
+void free_trainer(NNTrainer* trainer);
+
+// --- Operations ---
+// Same contract as train_batch(): one update with the mean gradient of n samples
+void trainer_step(NNTrainer* trainer, const double* inputs, const double* targets, int n, double learning_rate);
+int trainer_threads(const NNTrainer* trainer);
+
+#endif